@@ -1,13 +1,16 @@
 #version 330 core
 /* simpleGL freetype font vertex shader */
-layout (location = 0) in vec4 vertex;	// vec4 = vec2 pos (xy) + vec2 tex (zw)
+layout (location = 0) in vec2 in_position;
+layout (location = 1) in vec2 in_texcoord;
+layout (location = 2) in vec3 in_color;
 out vec2 TexCoords;
+out vec3 textColor;
 
 uniform mat4 projection;
-uniform mat4 transform;
 
 void main()
 {
-	gl_Position = projection * transform * vec4(vertex.xy, 0.0, 1.0);
-	TexCoords = vertex.zw;
+	gl_Position = projection * vec4(in_position, 0.0, 1.0);
+	TexCoords = in_texcoord;
+	textColor = in_color;
 }
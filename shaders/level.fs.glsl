@@ -0,0 +1,17 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+in vec4 uv_rect;
+
+// Application data
+uniform sampler2D sampler0;
+
+// Output color
+layout(location = 0) out  vec4 color;
+
+void main()
+{
+	// Texture coordinates count whole textures, the texture repeats inside its part of the atlas
+	color = texture(sampler0, uv_rect.xy + fract(texcoord) * uv_rect.zw);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330
+
+// See LevelVertex
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec2 in_texcoord;
+layout (location = 2) in vec4 in_uv_rect;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec4 uv_rect;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	texcoord = in_texcoord;
+	uv_rect = in_uv_rect;
+	// Level vertices are already in world space
+	vec3 pos = projection * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
\ No newline at end of file
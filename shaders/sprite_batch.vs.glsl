@@ -0,0 +1,36 @@
+#version 330
+
+// Per vertex, from the geometry buffer
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec2 in_texcoord;
+
+// Per instance, see SpriteInstance
+layout (location = 2) in vec3 in_transform0;
+layout (location = 3) in vec3 in_transform1;
+layout (location = 4) in vec3 in_transform2;
+layout (location = 5) in vec4 in_uv_rect;
+layout (location = 6) in vec3 in_color;
+// Start time, frame time, frame count and loop flag of the sprite sheet animation
+layout (location = 7) in vec4 in_animation;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 fcolor;
+
+// Application data
+uniform mat3 projection;
+// Game time in seconds, the clock the animations were started on
+uniform float time;
+
+void main()
+{
+	// in_uv_rect is the first frame, the others follow it to the right. Same as Animation::frameAt.
+	float frame = floor(max(time - in_animation.x, 0.0) / in_animation.y);
+	float frame_count = in_animation.z;
+	frame = in_animation.w > 0.5 ? mod(frame, frame_count) : min(frame, frame_count - 1.0);
+	texcoord = in_uv_rect.xy + vec2(frame * in_uv_rect.z, 0.0) + in_texcoord * in_uv_rect.zw;
+	fcolor = in_color;
+	mat3 transform = mat3(in_transform0, in_transform1, in_transform2);
+	vec3 pos = projection * transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
\ No newline at end of file
@@ -1,13 +1,15 @@
 // internal
 #include "ai_system.hpp"
 #include "world_init.hpp"
-#include <queue>
+#include "pathfinding.hpp"
+#include "timer_wheel.hpp"
+#include "floating_text.hpp"
 
 void AISystem::init(RenderSystem *renderSystem) {
 	this->renderer_arg = renderSystem;
 }
 
-void AISystem::step(float elapsed_ms)
+void AISystem::step(float frame_ms)
 {
 	// Find a player is it exists, else, do nothing
 	if (registry.players.size() < 1)
@@ -21,105 +23,59 @@ void AISystem::step(float elapsed_ms)
 	}
 	Motion &playerMotion = registry.motions.get(playerEntity);
 
-	for (Entity &enemy : registry.enemies.entities)
-	{
-		// State for roaming
-		EnemyState& enemyState = registry.enemies.get(enemy).enemyState;
-		if (enemyState == EnemyState::ROAMING) {
-			if (registry.enemyMotions.has(enemy)) {
-				Motion& motion = registry.enemyMotions.get(enemy);
-				motion.velocity = vec2((uniform_dist(rng) - 0.5f)* 15.0f, (uniform_dist(rng) - 0.5f) * 15.0f);
-				if (length(playerMotion.position - motion.position) < aggroDistance) {
-					enemyState = EnemyState::PURSUING;
-				}
-			}
-		// State for pursuing and shooting at player
-		} else if (enemyState == EnemyState::PURSUING) {
-			if (registry.bosses.has(enemy) && registry.reloadTimes.has(enemy) && registry.meleeAttacks.has(enemy)) {
-				boss_enemy_pursue(enemy, elapsed_ms, playerMotion, enemyState);
-            }
-			else if (registry.reloadTimes.has(enemy))
-			{
-                ranged_enemy_pursue(enemy, elapsed_ms, playerMotion, enemyState);
-            } 
-			else if (registry.meleeAttacks.has(enemy))
-			{
-				Motion& enemyMotion = registry.enemyMotions.get(enemy);
-				if (length(playerMotion.position - enemyMotion.position) > meleeDistance) {
-					Pathfinder& pathfinder = registry.pathfinders.get(enemy);
-					chase_with_a_star(pathfinder, elapsed_ms, playerMotion, enemyMotion);
-				} else {
-					enemyState = EnemyState::ATTACK;
-				}
-            }
-		// State for avoiding obstacles MAY NOT NEED TO USE
-		} else if (enemyState == EnemyState::AVOIDWALL) {
-			if (registry.enemyMotions.has(enemy)) {
-				Motion& enemyMotion = registry.enemyMotions.get(enemy);
-				for (Entity &wall: registry.exposedWallMotions.entities) {
-					Motion& wallMotion = registry.exposedWallMotions.get(wall);
-					// If in collision course with the wall, go around it
-					vec2 wallEnemyDelta = enemyMotion.position - wallMotion.position;
-					if (length(abs(wallEnemyDelta)) > distanceToWalls) {
-						printf("Distance to wall: %f %f\n", length(abs(wallEnemyDelta)), distanceToWalls);
-						enemyState = EnemyState::PURSUING;
-					}
-				}
-			}
-		// State for attacking player
-		} else if (enemyState == EnemyState::ATTACK) {
-			if (registry.bosses.has(enemy) && registry.reloadTimes.has(enemy) && registry.meleeAttacks.has(enemy)) {
-				Motion& enemyMotion = registry.enemyMotions.get(enemy);
-				if (length(playerMotion.position - enemyMotion.position) < meleeDistance) {
-					MeleeAttack &meleeAttack = registry.meleeAttacks.get(enemy);
-					stop_and_melee(enemy, meleeAttack, elapsed_ms, playerMotion, playerEntity);
-					enemyState = EnemyState::PURSUING;
-				} else {
-					ReloadTime &counter = registry.reloadTimes.get(enemy);
-					stop_and_shoot(enemy, counter, elapsed_ms, playerMotion, !registry.necromancers.has(enemy));
-				}
-			}
-			else if (registry.reloadTimes.has(enemy)) {
-				ReloadTime &counter = registry.reloadTimes.get(enemy);
-				stop_and_shoot(enemy, counter, elapsed_ms, playerMotion, false);
-			} else if (registry.meleeAttacks.has(enemy)) {
-				MeleeAttack &meleeAttack = registry.meleeAttacks.get(enemy);
-				stop_and_melee(enemy, meleeAttack, elapsed_ms, playerMotion, playerEntity);
-				enemyState = EnemyState::PURSUING;
+	// Undo last frame's crowd separation, whatever runs below only sets the velocities it wants to change
+	for (size_t i = 0; i < registry.enemies.size(); i++) {
+		Entity &enemy = registry.enemies.entities[i];
+		if (registry.enemyMotions.has(enemy)) {
+			registry.enemyMotions.get(enemy).velocity = registry.enemies.components[i].aiVelocity;
+		}
+	}
+
+	// Behaviours of enemies that died are dropped, the rest resume if their wait is over
+	behaviours.cancel_unless([](Entity enemy) { return registry.enemies.has(enemy); });
+	behaviours.step(frame_ms);
+
+	// Paths that finished on the workers since last frame replace the old ones
+	path_service.sync_grid();
+	path_service.collect();
+	ai_frame++;
+	perceive(playerMotion, frame_ms);
+
+	// Drop the trees of enemies that died
+	for (auto it = planners.begin(); it != planners.end();) {
+		it = registry.enemies.has(it->first) ? std::next(it) : planners.erase(it);
+	}
+
+	// Enemies that think this frame, sorted by what they are and what they are doing. Enemies on their
+	// off frames keep the velocity from their last tick.
+	for (auto &typeBuckets : buckets) {
+		for (std::vector<EnemyTick> &bucket : typeBuckets) {
+			bucket.clear();
+		}
+	}
+	for (size_t i = 0; i < registry.enemies.size(); i++) {
+		Entity &enemy = registry.enemies.entities[i];
+		Enemy &enemyComp = registry.enemies.components[i];
+		const Perception &perception = perceptions[enemyComp.perception];
+		if (!perception.tick || !registry.enemyMotions.has(enemy)) {
+			continue;
+		}
+		buckets[(int)enemyComp.type][(int)enemyComp.enemyState].push_back(
+			{enemy, &enemyComp, &registry.enemyMotions.get(enemy), perception.elapsed_ms, perception.distance});
+	}
+
+	// Handlers only queue state changes, so every bucket sees the states from the start of the frame
+	transitions.clear();
+	for (int state = 0; state < (int)EnemyState::COUNT; state++) {
+		for (int type = 0; type < (int)EnemyType::COUNT; type++) {
+			if (!buckets[type][state].empty()) {
+				run_bucket((EnemyType)type, (EnemyState)state, buckets[type][state], playerMotion, playerEntity);
 			}
-		} else if (enemyState == EnemyState::TELEPORTING) {
-			if (registry.bosses.has(enemy)) {
-				Teleporter& bossTeleport = registry.teleporters.get(enemy);
-				Motion& enemyMotion = registry.enemyMotions.get(enemy);
-				if (!registry.teleporting.has(enemy)) {
-					Teleporting& teleporting = registry.teleporting.emplace(enemy);
-					teleporting.starting_time = 0;
-					bossTeleport.prevScale = enemyMotion.scale;
-				}
-				enemyMotion.velocity = vec2(0.0f, 0.0f);
-				if (bossTeleport.animation_time > 0) {
-					bossTeleport.animation_time -= elapsed_ms;
-				} else {
-					teleport_boss(enemy, playerMotion, enemyState);
-					// Restore enemy motion
-					enemyMotion.scale = bossTeleport.prevScale;
-					registry.teleporting.remove(enemy);
-					bossTeleport.animation_time = bossTeleport.max_teleport_time;
-				}
-            }
-		} else if (enemyState == EnemyState::SPAWN_MINIONS) {
-			Motion &enemyMotion = registry.enemyMotions.get(enemy);
-
-			Necromancer& necroComp = registry.necromancers.get(enemy);
-			necroComp.centerPosition = enemyMotion.position;
-			necroComp.spawningMinions = true;
-
-			// Reset time
-            ReloadTime &counter = registry.reloadTimes.get(enemy);
-            counter.counter_ms = original_ms;
-			enemyState = EnemyState::PURSUING;
 		}
 	}
+	for (StateTransition &transition : transitions) {
+		transition.enemy->enemyState = transition.state;
+	}
 
 	// Spawn minions outside of loop, or it will crash
 	for (Entity &necro: registry.necromancers.entities) {
@@ -135,19 +91,193 @@ void AISystem::step(float elapsed_ms)
 		Motion &bossMotion = registry.enemyMotions.get(teleporting);
 		Teleporting &teleportingComp = registry.teleporting.get(teleporting);
 		bossMotion.scale = bossMotion.scale * quadratic_bezier(teleportingComp.starting_time, teleportingComp.max_time);
-		teleportingComp.starting_time += elapsed_ms;
+		teleportingComp.starting_time += frame_ms;
+	}
+
+	// Steer away from neighbours on top of whatever the state machine chose
+	separate_enemies();
+
+	// Requests made this frame start running now
+	path_service.start_frame(path_budget_ms);
+}
+
+void AISystem::queue_transition(EnemyTick &tick, EnemyState from, EnemyState to)
+{
+	if (to != from) {
+		transitions.push_back({tick.enemy, to});
+	}
+}
+
+// One tight loop per bucket, every enemy in it is the same type in the same state
+void AISystem::run_bucket(EnemyType type, EnemyState state, std::vector<EnemyTick> &bucket, Motion &playerMotion, Entity &playerEntity)
+{
+	bool isBoss = type == EnemyType::COWBOY || type == EnemyType::NECROMANCER;
+
+	switch (state) {
+	case EnemyState::ROAMING:
+		for (EnemyTick &tick : bucket) {
+			tick.motion->velocity = vec2((uniform_dist(rng) - 0.5f)* 15.0f, (uniform_dist(rng) - 0.5f) * 15.0f);
+			if (tick.distance < aggroDistance) {
+				queue_transition(tick, state, EnemyState::PURSUING);
+			}
+		}
+		break;
+
+	// State for pursuing and shooting at player
+	case EnemyState::PURSUING:
+		for (EnemyTick &tick : bucket) {
+			EnemyState next = state;
+			if (isBoss) {
+				boss_enemy_pursue(tick.entity, tick.elapsed_ms, playerMotion, next);
+			} else if (type == EnemyType::RANGED) {
+				ranged_enemy_pursue(tick.entity, tick.elapsed_ms, playerMotion, next);
+			} else if (tick.distance > meleeDistance) {
+				Pathfinder& pathfinder = registry.pathfinders.get(tick.entity);
+				chase_player(pathfinder, tick.elapsed_ms, playerMotion, *tick.motion);
+			} else {
+				next = EnemyState::ATTACK;
+			}
+			queue_transition(tick, state, next);
+		}
+		break;
+
+	// State for avoiding obstacles MAY NOT NEED TO USE
+	case EnemyState::AVOIDWALL:
+		for (EnemyTick &tick : bucket) {
+			for (Entity &wall: registry.exposedWallMotions.entities) {
+				Motion& wallMotion = registry.exposedWallMotions.get(wall);
+				// If in collision course with the wall, go around it
+				vec2 wallEnemyDelta = tick.motion->position - wallMotion.position;
+				if (length(abs(wallEnemyDelta)) > distanceToWalls) {
+					printf("Distance to wall: %f %f\n", length(abs(wallEnemyDelta)), distanceToWalls);
+					queue_transition(tick, state, EnemyState::PURSUING);
+					break;
+				}
+			}
+		}
+		break;
+
+	// State for attacking player, the attack itself runs as a behaviour
+	case EnemyState::ATTACK:
+		for (EnemyTick &tick : bucket) {
+			// Marked first, a behaviour that has nothing to wait for finishes before start() is even called
+			tick.enemy->acting = true;
+			if (type == EnemyType::RANGED || (isBoss && tick.distance >= meleeDistance)) {
+				behaviours.start(tick.entity, shoot_volley(tick.entity, playerEntity, type == EnemyType::COWBOY));
+			} else {
+				behaviours.start(tick.entity, melee_strike(tick.entity, playerEntity));
+			}
+		}
+		break;
+
+	case EnemyState::TELEPORTING:
+		if (!isBoss) {
+			break;
+		}
+		for (EnemyTick &tick : bucket) {
+			tick.enemy->acting = true;
+			behaviours.start(tick.entity, teleport_sequence(tick.entity, playerEntity));
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Boids style separation. Enemies are binned into a coarse grid first, so each one only looks at the
+// few enemies in the 3x3 bins around it instead of at every other enemy.
+void AISystem::separate_enemies()
+{
+	crowdMotions.clear();
+	crowdEnemies.clear();
+	for (size_t i = 0; i < registry.enemies.size(); i++) {
+		Entity &enemy = registry.enemies.entities[i];
+		if (registry.enemyMotions.has(enemy)) {
+			crowdMotions.push_back(&registry.enemyMotions.get(enemy));
+			crowdEnemies.push_back(&registry.enemies.components[i]);
+		}
+	}
+	// Whatever the AI set this frame is what gets restored before the next one
+	for (size_t i = 0; i < crowdMotions.size(); i++) {
+		crowdEnemies[i]->aiVelocity = crowdMotions[i]->velocity;
+	}
+	std::vector<Motion *> &motions = crowdMotions;
+	if (motions.size() < 2 || registry.gridMaps.size() <= 0) {
+		return;
+	}
+	GridMap &gridMapComp = registry.gridMaps.components[0];
+	ivec2 bins = max(ivec2(ceil(vec2(gridMapComp.mapWidth, gridMapComp.mapHeight) / crowdBinSize)), ivec2(1));
+	auto binOf = [&](vec2 position) {
+		return clamp(ivec2(floor(position / crowdBinSize)), ivec2(0), bins - 1);
+	};
+
+	// Counting sort of the enemies by bin, crowdBinStart[b] .. crowdBinStart[b + 1] are the enemies in bin b
+	crowdBinStart.assign(bins.x * bins.y + 1, 0);
+	for (Motion *motion : motions) {
+		ivec2 bin = binOf(motion->position);
+		crowdBinStart[bin.y * bins.x + bin.x + 1]++;
+	}
+	for (size_t b = 1; b < crowdBinStart.size(); b++) {
+		crowdBinStart[b] += crowdBinStart[b - 1];
+	}
+	crowdBinned.resize(motions.size());
+	crowdFill.assign(crowdBinStart.begin(), crowdBinStart.end() - 1);
+	for (int i = 0; i < (int)motions.size(); i++) {
+		ivec2 bin = binOf(motions[i]->position);
+		crowdBinned[crowdFill[bin.y * bins.x + bin.x]++] = i;
+	}
+
+	// Pushes are all measured before any velocity changes, so the result doesn't depend on the order
+	crowdPush.assign(motions.size(), vec2(0.0f));
+	for (int i = 0; i < (int)motions.size(); i++) {
+		const Motion &motion = *motions[i];
+		float radius = 0.5f * max(abs(motion.scale.x), abs(motion.scale.y));
+		ivec2 bin = binOf(motion.position);
+		for (int y = max(bin.y - 1, 0); y <= min(bin.y + 1, bins.y - 1); y++) {
+			for (int x = max(bin.x - 1, 0); x <= min(bin.x + 1, bins.x - 1); x++) {
+				int b = y * bins.x + x;
+				for (int k = crowdBinStart[b]; k < crowdBinStart[b + 1]; k++) {
+					int j = crowdBinned[k];
+					if (j == i) {
+						continue;
+					}
+					const Motion &other = *motions[j];
+					float spacing = radius + 0.5f * max(abs(other.scale.x), abs(other.scale.y)) + separationMargin;
+					vec2 delta = motion.position - other.position;
+					float distance = length(delta);
+					if (distance >= spacing) {
+						continue;
+					}
+					// Stacked exactly on top of each other, split them sideways by index
+					vec2 away = distance > 0.0001f ? delta / distance : vec2(i < j ? -1.0f : 1.0f, 0.0f);
+					crowdPush[i] += away * (spacing - distance) / spacing;
+				}
+			}
+		}
+	}
+
+	// Blended into the path direction rather than replacing it, and never faster than the enemy or the push
+	for (int i = 0; i < (int)motions.size(); i++) {
+		if (crowdPush[i] == vec2(0.0f)) {
+			continue;
+		}
+		Motion &motion = *motions[i];
+		float speed = max(length(motion.velocity), separationSpeed);
+		vec2 blended = motion.velocity + crowdPush[i] * separationSpeed;
+		if (length(blended) > speed) {
+			blended = normalize(blended) * speed;
+		}
+		motion.velocity = blended;
 	}
 }
 
 // Prevent collision with obstacles
 bool wall_distance_helper(vec2 &position) {
-	for (Entity &wall: registry.exposedWallMotions.entities) {
-		Motion& wallMotion = registry.exposedWallMotions.get(wall);
-		if (length(position - wallMotion.position) <  75.f) {
-			return false;
-		}
+	if (registry.gridMaps.size() <= 0) {
+		return false;
 	}
-	return true;
+	return registry.gridMaps.components[0].wallDistance(position) >= MINION_SPAWN_CLEARANCE;
 }
 
 void AISystem::spawn_minions(glm::vec2 &position)
@@ -171,32 +301,13 @@ void AISystem::spawn_minions(glm::vec2 &position)
 
 void AISystem::teleport_boss(Entity &enemy, Motion &playerMotion, EnemyState &enemyState)
 {
-    bool is_valid_spawn = false;
-    vec2 spawn_pos;
     Motion &enemyMotion = registry.enemyMotions.get(enemy);
 
-    while (!is_valid_spawn)
+    // Somewhere clear of walls and not on top of the player, staying put if there is no such place
+    vec2 spawn_pos = enemyMotion.position;
+    if (registry.gridMaps.size() > 0)
     {
-        spawn_pos = {
-            150.f + uniform_dist(rng) * (window_width_px - 300.f),
-            150.f + uniform_dist(rng) * (window_height_px - 300.f)};
-        is_valid_spawn = true;
-
-        // Check if it collides with the player
-        if (length(playerMotion.position - spawn_pos) < 100.0f)
-        {
-            is_valid_spawn = false;
-        }
-
-        for (Entity entity : registry.walls.entities)
-        {
-            Motion &wall_motion = registry.wallMotions.get(entity);
-            if (length(wall_motion.position - spawn_pos) < 100.f)
-            {
-                is_valid_spawn = false;
-                break;
-            }
-        }
+        pickSpawnPosition(registry.gridMaps.components[0], SPAWN_CLEARANCE, playerMotion.position, TELEPORT_AVOID_DISTANCE, rng, spawn_pos);
     }
     enemyMotion.position = spawn_pos;
 	Pathfinder& pathfinder = registry.pathfinders.get(enemy);
@@ -211,22 +322,17 @@ void AISystem::teleport_boss(Entity &enemy, Motion &playerMotion, EnemyState &en
 // Pursuing logic for a ranged enemy, including shoot
 void AISystem::ranged_enemy_pursue(Entity &enemy, float elapsed_ms, Motion &playerMotion, EnemyState &enemyState)
 {
-    ReloadTime &counter = registry.reloadTimes.get(enemy);
-    // to prevent overflow
-    if (counter.counter_ms > 0)
-    {
-        counter.counter_ms -= elapsed_ms;
-    }
+    bool reloaded = !timers.pending(enemy, TimerKind::RELOAD);
     // context_chase(enemy, playerMotion);
 	Pathfinder &pathfinder = registry.pathfinders.get(enemy);
 	Motion& enemyMotion = registry.enemyMotions.get(enemy);
 	// update the path with A* every few seconds
-    chase_with_a_star(pathfinder, elapsed_ms, playerMotion, enemyMotion);
+    chase_player(pathfinder, elapsed_ms, playerMotion, enemyMotion);
 
 
     float FURTHEST_SHOOTING_RANGE = 350.f;
-    float dist = length(playerMotion.position - enemyMotion.position);
-    if (!line_of_sight_check(enemy, playerMotion) && dist < FURTHEST_SHOOTING_RANGE && counter.counter_ms < 0)
+    float dist = perception_of(enemy, playerMotion).distance;
+    if (!line_of_sight_check(enemy, playerMotion) && dist < FURTHEST_SHOOTING_RANGE && reloaded)
     {
         enemyState = EnemyState::ATTACK;
     }
@@ -234,12 +340,7 @@ void AISystem::ranged_enemy_pursue(Entity &enemy, float elapsed_ms, Motion &play
 
 void AISystem::boss_enemy_pursue(Entity &enemy, float elapsed_ms, Motion &playerMotion, EnemyState &enemyState)
 {
-    ReloadTime &counter = registry.reloadTimes.get(enemy);
-    // to prevent overflow
-    if (counter.counter_ms > 0)
-    {
-        counter.counter_ms -= elapsed_ms;
-    }
+    bool reloaded = !timers.pending(enemy, TimerKind::RELOAD);
 
 	Motion& enemyMotion = registry.enemyMotions.get(enemy);
 
@@ -247,207 +348,219 @@ void AISystem::boss_enemy_pursue(Entity &enemy, float elapsed_ms, Motion &player
 	Pathfinder &pathfinder = registry.pathfinders.get(enemy);
 
 	// update the path with A* every few seconds
-    chase_with_a_star(pathfinder, elapsed_ms, playerMotion, enemyMotion);
+    chase_player(pathfinder, elapsed_ms, playerMotion, enemyMotion);
 
 	int attackRand = rand() % 2;
-	if (attackRand == 0 && counter.counter_ms < 0) {
+	if (attackRand == 0 && reloaded) {
 		enemyState = EnemyState::TELEPORTING;
 	}
-    if ((!line_of_sight_check(enemy, playerMotion) && counter.counter_ms < 0) || length(playerMotion.position - enemyMotion.position) < meleeDistance)
+    if ((!line_of_sight_check(enemy, playerMotion) && reloaded) || perception_of(enemy, playerMotion).distance < meleeDistance)
     {
 		enemyState = EnemyState::ATTACK;
     }
 }
 
+void AISystem::chase_player(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion)
+{
+	if (pathfinder.mode == PathMode::FLOW_FIELD) {
+		chase_with_flow_field(pathfinder, elapsed_ms, playerMotion, enemyMotion);
+	} else if (pathfinder.mode == PathMode::INCREMENTAL) {
+		chase_with_planner(pathfinder, elapsed_ms, playerMotion, enemyMotion);
+	} else {
+		chase_with_a_star(pathfinder, elapsed_ms, playerMotion, enemyMotion);
+	}
+}
+
 void AISystem::chase_with_a_star(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion)
 {
-    if (pathfinder.refresh_rate > 0)
+    if (!timers.pending(enemyMotion.entity, TimerKind::PATH_REFRESH))
     {
-        pathfinder.refresh_rate -= elapsed_ms;
-    }
-    else
-    {
-        update_path(playerMotion, enemyMotion, pathfinder);
+        // Keeps following the current path until the new one comes back
+        request_path(playerMotion, enemyMotion, pathfinder);
 
         // reset timer
-        pathfinder.refresh_rate = pathfinder.max_refresh_rate;
+        timers.schedule(enemyMotion.entity, TimerKind::PATH_REFRESH, pathfinder.max_refresh_rate);
     }
-	interpolate_pathfinding(enemyMotion, pathfinder, playerMotion);
+	interpolate_pathfinding(enemyMotion, pathfinder, playerMotion, elapsed_ms);
 }
 
-void AISystem::update_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder &pathfinder)
+FlowField &AISystem::flow_field_for(int clearance)
+{
+	for (FlowField &field : flow_fields) {
+		if (field.clearance == clearance) {
+			return field;
+		}
+	}
+	flow_fields.emplace_back();
+	flow_fields.back().clearance = clearance;
+	return flow_fields.back();
+}
+
+void AISystem::chase_with_flow_field(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion)
 {
 	if (registry.gridMaps.size() <= 0) {
 		return;
 	}
-    auto &gridEntity = registry.gridMaps.entities[0];
-    GridMap &gridMapComp = registry.gridMaps.get(gridEntity);
-    auto &gridMap = gridMapComp.gridMap;
-	if (gridMap.size() <= 0) {
+	GridMap &gridMapComp = registry.gridMaps.components[0];
+
+	// Only rebuilt when the player changes cells, every enemy after the first just reads it
+	FlowField &field = flow_field_for(pathfinder.clearance);
+	field.update(gridMapComp, registry.gridMaps.entities[0], gridMapComp.cellAt(playerMotion.position));
+
+	bool reached;
+	int next = field.nextCell(gridMapComp, gridMapComp.cellAt(enemyMotion.position), reached);
+	if (reached) {
+		enemyMotion.velocity = {0.0f, 0.0f};
+		return;
+	}
+	// Stuck somewhere the field doesn't cover, let A* find a way out
+	if (next == -1) {
+		chase_with_a_star(pathfinder, elapsed_ms, playerMotion, enemyMotion);
 		return;
 	}
-    vec2 playerToCoord = playerMotion.position / vec2(gridMapComp.mapWidth, gridMapComp.mapHeight);
-	playerToCoord = clamp(playerToCoord, vec2(0.0), vec2(0.99));
-    int x_player = (int)floor(playerToCoord.x * gridMap[0].size());
-    int y_player = (int)floor(playerToCoord.y * gridMap.size());
-    vec2 enemyToCoord = enemyMotion.position / vec2(gridMapComp.mapWidth, gridMapComp.mapHeight);
-	enemyToCoord = clamp(enemyToCoord, vec2(0.0), vec2(0.99));
-    uint x_enemy = (uint)floor(enemyToCoord.x * gridMap[0].size());
-    uint y_enemy = (uint)floor(enemyToCoord.y * gridMap.size());
-    // printf("player x: %d \n", x_player);
-    // printf("player y: %d \n", y_player);
-    // printf("%d: enemy y \n", y_enemy);
-    // printf("%d: enemy x \n", x_enemy);
-    astar_pathfinding(gridMapComp, &gridMap[y_enemy][x_enemy], &gridMap[y_player][x_player], pathfinder);
+
+	vec2 direction = normalize(gridMapComp.cellCenter(next) - enemyMotion.position);
+	enemyMotion.velocity = direction * meleeEnemySpeed;
+	vec2 angleDelta = normalize(enemyMotion.position - playerMotion.position);
+	enemyMotion.angle = atan2(-angleDelta.y, -angleDelta.x);
 }
 
-// Perform a light of sight check to see if there are any obstacles between the ranged enemy and the player
-bool AISystem::line_of_sight_check(Entity &enemy, Motion &playerMotion) {
-	Motion& enemyMotion = registry.enemyMotions.get(enemy);
-	vec2 deltaEnemyPlayer = enemyMotion.position - playerMotion.position;
-	for (Entity &obstacle: registry.exposedWallMotions.entities) {
-		Motion &wallMotion = registry.exposedWallMotions.get(obstacle);
-		if (line_box_collision(enemyMotion, wallMotion, deltaEnemyPlayer)) {
-			return true;
-		}
+void AISystem::chase_with_planner(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion)
+{
+	if (registry.gridMaps.size() <= 0) {
+		return;
+	}
+	GridMap &gridMapComp = registry.gridMaps.components[0];
+	if (gridMapComp.cellCount() <= 0 || (int)gridMapComp.clearance.size() != gridMapComp.cellCount()) {
+		return;
 	}
-	return false;
-}
 
-// Whether the line and AABB intersect, not really the smartest method, iterate through points on the line and return true if it intersects
-bool AISystem::line_box_collision(Motion &enemyMotion, Motion &obstacleMotion, vec2 &directionDelta) {
-	vec2 normalizedDelta = normalize(directionDelta);
-	vec2 increment = los_increment * normalizedDelta;
-	vec2 curr = vec2(0, 0);
-	vec2 bounding_box = vec2(abs(obstacleMotion.scale.x), abs(obstacleMotion.scale.y));
-	float left = obstacleMotion.position.x - bounding_box.x/2;
-	float right = obstacleMotion.position.x + bounding_box.x/2;
-	float bot = obstacleMotion.position.y + bounding_box.y/2;
-	float top = obstacleMotion.position.y - bounding_box.y/2;
-	// Added to prevent infinite loops
-	int tries = 0;
-	while ((length(curr) < length(directionDelta)) && tries < 1000) {
-		curr += increment;
-		tries += 1;
-		vec2 curr_pos = enemyMotion.position + curr;
-		if (curr_pos.x > left && curr_pos.x < right && curr_pos.y > top && curr_pos.y < bot) {
-			return true;
-		}
+	// Cheap enough to run every frame, it only searches when the boss or the player changed cells
+	MovingTargetPlanner &planner = planners[enemyMotion.entity];
+	bool found = planner.plan(gridMapComp, registry.gridMaps.entities[0], gridMapComp.cellAt(enemyMotion.position),
+		gridMapComp.cellAt(playerMotion.position), pathfinder.clearance, pathfinder.path);
+
+	// No wide enough way to the player, the timed A* can still squeeze past walls near them
+	if (!found) {
+		chase_with_a_star(pathfinder, elapsed_ms, playerMotion, enemyMotion);
+		return;
 	}
-	return false;
+	interpolate_pathfinding(enemyMotion, pathfinder, playerMotion, elapsed_ms);
 }
 
-// Comparator
-struct CompareCosts {
-	bool operator()(GridNode* gn1, GridNode* gn2) {
-		return gn1->fCost() > gn2->fCost();
+void AISystem::update_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder &pathfinder)
+{
+	if (registry.gridMaps.size() <= 0) {
+		return;
 	}
-};
+    GridMap &gridMapComp = registry.gridMaps.components[0];
+	if (gridMapComp.cellCount() <= 0) {
+		return;
+	}
+    ivec2 playerCell = gridMapComp.cellAt(playerMotion.position);
+    ivec2 enemyCell = gridMapComp.cellAt(enemyMotion.position);
+    path_service.sync_grid();
+    path_service.find_path_now(enemyCell, playerCell, pathfinder.clearance, pathfinder.path);
+}
 
-// Inspired by https://www.geeksforgeeks.org/a-search-algorithm/
-// A star for smart chasing, requires grid system to work
-void AISystem::astar_pathfinding(GridMap& grid, GridNode* startNode, GridNode* endNode, Pathfinder &pathfinder) {
-	auto &gridMap = grid.gridMap;
-	std::priority_queue<GridNode*, std::vector<GridNode*>, CompareCosts> openSet;
-	std::vector<std::vector<bool>> closedSet(gridMap.size(), std::vector<bool>(gridMap[0].size(), false));
-	startNode->gCost = 0.0f;
-	openSet.push(startNode);
-	while(!openSet.empty()) {
-		// Get the top of the queue
-		GridNode* curr = openSet.top();
-		openSet.pop();
-
-		// Create the path
-		// Within one block away
-		bool withinRange = 
-			(curr->coord == endNode->coord) || 
-			(abs(curr->coord.x - endNode->coord.x) == 1 && curr->coord.y == endNode->coord.y) || 
-			(abs(curr->coord.y - endNode->coord.y) == 1 && curr->coord.x == endNode->coord.x) || 
-			(abs(curr->coord.x - endNode->coord.x) == 1 && abs(curr->coord.y - endNode->coord.y) == 1);
-		if (withinRange) {
-			std::vector<GridNode*> path;
-			GridNode* tp = curr;
-			while (tp != nullptr) {
-                path.push_back(tp);
-                tp = tp->parentNode;
-            }
-            std::reverse(path.begin(), path.end());
-			// Remove the first element to prevent jittering
-			path.erase(path.begin());
-			pathfinder.path = path;
-			reset_grid(grid);
-			return;
-		}
+// Closest enemies to the player get their path first
+void AISystem::request_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder &pathfinder)
+{
+	if (registry.gridMaps.size() <= 0) {
+		return;
+	}
+	GridMap &gridMapComp = registry.gridMaps.components[0];
+	float priority = length(playerMotion.position - enemyMotion.position);
+	path_service.request(enemyMotion.entity, gridMapComp.cellAt(enemyMotion.position), gridMapComp.cellAt(playerMotion.position), pathfinder.clearance, priority);
+}
 
-		closedSet[curr->coord.y][curr->coord.x] = true;
-		
-		// Possible directions
-		std::vector<ivec2> directions = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}, {1, 1}, {1,-1}, {-1, -1}, {-1, 1}};
-		for (auto &direction: directions) {
-			ivec2 nextCoord = curr->coord + direction;
-
-            if (nextCoord.x < 0 || nextCoord.y < 0 || nextCoord.x >= gridMap[0].size() || nextCoord.y >= gridMap.size())
-                continue;
-
-			GridNode* neighbor = &grid.gridMap[nextCoord.y][nextCoord.x];
-
-			// Give enemy some space
-			bool notWalkable = neighbor->notWalkable;
-			for (auto &wallDirection: directions) {
-				ivec2 nextNextCoord = nextCoord + wallDirection;
-				if (nextNextCoord.x < 0 || nextNextCoord.y < 0 || nextNextCoord.x >= gridMap[0].size() || nextNextCoord.y >= gridMap.size())
-                	continue;
-				GridNode* neighborNeighbor = &grid.gridMap[nextNextCoord.y][nextNextCoord.x];
-				if (neighborNeighbor->notWalkable) {
-					notWalkable = true;
-				}
-				if (!neighbor->notWalkable && (neighborNeighbor->coord == endNode->coord)) {
-					notWalkable = false;
-					break;
-				}
-			}
+// Distance, line of sight and aggro for every enemy at once, the rest of the step only reads them
+void AISystem::perceive(Motion &playerMotion, float frame_ms)
+{
+	this->frame_ms = frame_ms;
+	// Whatever the camera shows this frame, grown by the margin
+	if (renderer_arg != nullptr && renderer_arg->getWindow() != nullptr) {
+		renderer_arg->getViewRect(view_min, view_max);
+	} else {
+		view_min = playerMotion.position - vec2(window_width_px, window_height_px) / 2.0f;
+		view_max = playerMotion.position + vec2(window_width_px, window_height_px) / 2.0f;
+	}
+	view_min -= vec2(lodScreenMargin);
+	view_max += vec2(lodScreenMargin);
 
-			// Avoid walls and previously visited
-			if (notWalkable || closedSet[nextCoord.y][nextCoord.x]) {
-				continue;
-			}
+	perceptions.clear();
+	for (Entity &enemy : registry.enemies.entities) {
+		perceive_enemy(enemy, playerMotion);
+	}
+}
 
-			float tempGCost = curr->gCost + 1.0f;
-			if (tempGCost < neighbor->gCost) {
-				neighbor->gCost = tempGCost;
-				neighbor->hCost = length((vec2) nextCoord - (vec2) endNode->coord);
-				neighbor->parentNode = curr;
-				openSet.push(neighbor);
-			}
-		}
+// Level of detail: enemies on screen or close to the player think every frame, the rest every
+// lodMidPeriod or lodFarPeriod frames. Ticks are spread over the frames by entity id, and each
+// tick gets all the time that passed since the enemy's last one.
+void AISystem::perceive_enemy(Entity &enemy, Motion &playerMotion)
+{
+	perceptions.emplace_back();
+	Perception &perception = perceptions.back();
+	Enemy &enemyComp = registry.enemies.get(enemy);
+	enemyComp.perception = (int)perceptions.size() - 1;
+	enemyComp.perceivedFrame = ai_frame;
+	if (!registry.enemyMotions.has(enemy)) {
+		return;
+	}
+	Motion &enemyMotion = registry.enemyMotions.get(enemy);
+	vec2 delta = abs(enemyMotion.position - playerMotion.position);
+	perception.distance = length(delta);
+	perception.inAggroRange = perception.distance < aggroDistance;
+
+	bool onScreen = all(greaterThanEqual(enemyMotion.position, view_min)) && all(lessThanEqual(enemyMotion.position, view_max));
+	unsigned int period = 1;
+	if (!onScreen && !perception.inAggroRange) {
+		period = perception.distance < lodMidDistance ? lodMidPeriod : lodFarPeriod;
+	}
+	// Behaviours keep their own time
+	if (enemyComp.acting) {
+		enemyComp.aiPendingMs = 0.0f;
+		return;
 	}
-	reset_grid(grid);
+	enemyComp.aiPendingMs += frame_ms;
+	perception.tick = (ai_frame + (unsigned int)enemy) % period == 0;
+	if (!perception.tick) {
+		return;
+	}
+	perception.elapsed_ms = enemyComp.aiPendingMs;
+	enemyComp.aiPendingMs = 0.0f;
+	perception.lineOfSight = registry.gridMaps.size() <= 0 ||
+		registry.gridMaps.components[0].lineOfSight(enemyMotion.position, playerMotion.position);
 }
 
-void AISystem::reset_grid(GridMap &gridMap) {
-	auto &gridMatrix = gridMap.gridMap;
-	for (int i = 0; i < gridMatrix[0].size(); i++) {
-		for (int j = 0; j < gridMatrix.size(); j++) {
-			auto &gridNode = gridMatrix[j][i];
-			gridNode.gCost = 1e9;
-			gridNode.hCost = 0.0f;
-			gridNode.parentNode = nullptr;
-		}
+const AISystem::Perception &AISystem::perception_of(Entity &enemy, Motion &playerMotion)
+{
+	// Minions spawned during this step have not been perceived yet
+	Enemy &enemyComp = registry.enemies.get(enemy);
+	if (enemyComp.perceivedFrame != ai_frame) {
+		perceive_enemy(enemy, playerMotion);
 	}
+	return perceptions[enemyComp.perception];
+}
+
+// True when a wall is between the enemy and the player
+bool AISystem::line_of_sight_check(Entity &enemy, Motion &playerMotion) {
+	return !perception_of(enemy, playerMotion).lineOfSight;
 }
 
 // Go along the path
-void AISystem::interpolate_pathfinding(Motion &enemyMotion, Pathfinder &pathfinder, Motion &playerMotion) {
-	if (pathfinder.path.size() > 0) {
-		auto &closestPoint = pathfinder.path.front();
-		vec2 &gridPosition = closestPoint->position;
+void AISystem::interpolate_pathfinding(Motion &enemyMotion, Pathfinder &pathfinder, Motion &playerMotion, float elapsed_ms) {
+	if (!pathfinder.path.empty() && registry.gridMaps.size() > 0) {
+		vec2 gridPosition = registry.gridMaps.components[0].cellCenter(pathfinder.path.front());
 		vec2 delta = enemyMotion.position - gridPosition;
 		vec2 direction = normalize(gridPosition - enemyMotion.position);
 		enemyMotion.velocity = direction * meleeEnemySpeed;
 		vec2 angleDelta = normalize(enemyMotion.position - playerMotion.position);
 		enemyMotion.angle = atan2(-angleDelta.y, -angleDelta.x);
-		if (length(delta) < 2.0f) {
-			pathfinder.path.erase(pathfinder.path.begin()); 
+		// Enemies that only tick every few frames move further in between, count the cell as reached
+		// once they would get there before their next tick
+		if (length(delta) < max(2.0f, meleeEnemySpeed * elapsed_ms / 1000.0f)) {
+			pathfinder.path.pop_front();
 		}
 	} else {
 		enemyMotion.velocity = {0.0f, 0.0f};
@@ -524,87 +637,131 @@ void AISystem::context_chase(Entity &enemy,  Motion &playerMotion) {
 	enemyMotion.angle = atan2(-enemyPlayerDelta.y, -enemyPlayerDelta.x);
 }
 
-// Stop, winds up, and performs a melee attack on the player
-void AISystem::stop_and_melee(Entity &enemy, MeleeAttack &counter, float elapsed_ms, Motion &playerMotion, Entity &playerEntity) {
-	if (registry.enemyMotions.has(enemy)) 
-	{
-		counter.windup -= elapsed_ms;
-		Motion& enemyMotion = registry.enemyMotions.get(enemy);
-		enemyMotion.velocity = vec2(0.0f, 0.0f);
+// Stands still through the windup, then hits the player if they are still in reach
+BehaviourTask AISystem::melee_strike(Entity enemy, Entity playerEntity)
+{
+	registry.enemyMotions.get(enemy).velocity = vec2(0.0f, 0.0f);
+	co_await behaviours.sleep(registry.meleeAttacks.get(enemy).windupMax);
 
-		bool causeDamage = true;
+	// Components may have moved while asleep, so everything is looked up again
+	Motion &enemyMotion = registry.enemyMotions.get(enemy);
+	if (registry.motions.has(playerEntity) &&
+		length(registry.motions.get(playerEntity).position - enemyMotion.position) < meleeDistance) {
+		melee_hit(registry.meleeAttacks.get(enemy), playerEntity);
+	}
+	finish_behaviour(enemy, EnemyState::PURSUING);
+}
 
-		for (Entity entity : registry.powerUps.entities) {
-			PowerUp &powerUp = registry.powerUps.get(entity);
-			if (powerUp.active && powerUp.type == PowerUpType::INVINCIBILITY) {
-				causeDamage = false;
-			}
+// Performs a melee attack on the player
+void AISystem::melee_hit(MeleeAttack &counter, Entity &playerEntity) {
+	bool causeDamage = true;
+
+	for (Entity entity : registry.powerUps.entities) {
+		PowerUp &powerUp = registry.powerUps.get(entity);
+		if (powerUp.active && powerUp.type == PowerUpType::INVINCIBILITY) {
+			causeDamage = false;
 		}
+	}
 
-		if (counter.windup < 0) {
-			if (registry.healths.has(playerEntity ) && causeDamage) {
-				Health &playerHealth = registry.healths.get(playerEntity);
-				Motion &playerMotion = registry.motions.get(playerEntity);
-				playerHealth.value -= counter.damage;
-                int w, h;
-                glfwGetWindowSize(renderer_arg->getWindow(), &w, &h);
-                int cameraOffsetX = w/2 - playerMotion.position.x;
-                // Motion.position assumes top right is (window_width_px, window_height_px) when the y axis is actually flipped, so negative offset
-                int cameraOffsetY = -(h/2 - (h - playerMotion.position.y));
-                vec2 cameraOffset = vec2(cameraOffsetX, cameraOffsetY);
-				createText(renderer_arg, "-" + std::to_string(counter.damage), playerMotion.position + cameraOffset, 1.25f, {1.f, 0.f, 0.133f});
-				if (registry.damageEffect.has(playerEntity)) {
-					DamageEffect &effect = registry.damageEffect.get(playerEntity);
-					effect.is_attacked = true;
-				}
+	if (registry.healths.has(playerEntity) && causeDamage) {
+		Health &playerHealth = registry.healths.get(playerEntity);
+		Motion &playerMotion = registry.motions.get(playerEntity);
+		playerHealth.value -= counter.damage;
+		int w, h;
+		glfwGetWindowSize(renderer_arg->getWindow(), &w, &h);
+		int cameraOffsetX = w/2 - playerMotion.position.x;
+		// Motion.position assumes top right is (window_width_px, window_height_px) when the y axis is actually flipped, so negative offset
+		int cameraOffsetY = -(h/2 - (h - playerMotion.position.y));
+		vec2 cameraOffset = vec2(cameraOffsetX, cameraOffsetY);
+		floatingTexts.spawn(playerMotion.position + cameraOffset, 1.25f, {1.f, 0.f, 0.133f}, "-%d", counter.damage);
+		if (registry.damageEffect.has(playerEntity)) {
+			DamageEffect &effect = registry.damageEffect.get(playerEntity);
+			if (!effect.is_attacked) {
+				timers.schedule(playerEntity, TimerKind::DAMAGE_EFFECT, effect.max_show_time);
 			}
-			counter.windup = counter.windupMax;
+			effect.is_attacked = true;
 		}
 	}
 }
 
-// Stops and shoots at the enemy at a certain rate
-void AISystem::stop_and_shoot(Entity &enemy, ReloadTime &counter, float elapsed_ms, Motion &playerMotion, bool boss)
+// Stops and takes aim, firing every shoot_rate until aiming is over, then reloads
+BehaviourTask AISystem::shoot_volley(Entity enemy, Entity playerEntity, bool shotgun)
 {
-    if (registry.enemyMotions.has(enemy))
-    {
-        counter.take_aim_ms -= elapsed_ms;
-		counter.shoot_rate -= elapsed_ms;
-        Motion &enemyMotion = registry.enemyMotions.get(enemy);
-        enemyMotion.velocity = vec2(0.0f, 0.0f);
-
-		if (counter.shoot_rate < 0) {
-			if (boss) {
-				shotgun_enemy(enemyMotion, playerMotion, counter);
-			} 
-			else 
-			{
-				single_shot_enemy(enemyMotion, playerMotion, counter);
-			}
-        }
+	registry.enemyMotions.get(enemy).velocity = vec2(0.0f, 0.0f);
+
+	float aimed = 0.0f;
+	while (aimed + shoot_rate <= take_aim_ms) {
+		co_await behaviours.sleep(shoot_rate);
+		aimed += shoot_rate;
+		if (!registry.motions.has(playerEntity)) {
+			break;
+		}
+		Motion &enemyMotion = registry.enemyMotions.get(enemy);
+		Motion &playerMotion = registry.motions.get(playerEntity);
+		if (shotgun) {
+			shotgun_enemy(enemyMotion, playerMotion);
+		} else {
+			single_shot_enemy(enemyMotion, playerMotion);
+		}
+	}
+	if (aimed < take_aim_ms) {
+		co_await behaviours.sleep(take_aim_ms - aimed);
+	}
 
-        if (counter.take_aim_ms < 0)
-        {
-			Enemy &enemyState = registry.enemies.get(enemy);
-			counter.shoot_rate = shoot_rate;
-            counter.counter_ms = original_ms;
-            counter.take_aim_ms = take_aim_ms;
-			enemyState.enemyState = EnemyState::PURSUING;
-        }
-    }
+	timers.schedule(enemy, TimerKind::RELOAD, registry.reloadTimes.get(enemy).reload_ms);
+	finish_behaviour(enemy, EnemyState::PURSUING);
+}
+
+// Shrinks away, reappears somewhere else and, for the necromancer, raises minions there
+BehaviourTask AISystem::teleport_sequence(Entity boss, Entity playerEntity)
+{
+	Motion &bossMotion = registry.enemyMotions.get(boss);
+	// A teleport loaded from a save is already under way and bossMotion.scale has shrunk since then.
+	// starting_time counts the time it has been going, so it only sleeps for what was left.
+	if (!registry.teleporting.has(boss)) {
+		registry.teleporting.emplace(boss);
+		registry.teleporting.get(boss).starting_time = 0;
+		registry.teleporters.get(boss).prevScale = bossMotion.scale;
+	}
+	bossMotion.velocity = vec2(0.0f, 0.0f);
+	co_await behaviours.sleep(registry.teleporters.get(boss).max_teleport_time - registry.teleporting.get(boss).starting_time);
+
+	EnemyState next = EnemyState::ATTACK;
+	if (registry.motions.has(playerEntity)) {
+		teleport_boss(boss, registry.motions.get(playerEntity), next);
+	}
+	// Restore enemy motion
+	registry.enemyMotions.get(boss).scale = registry.teleporters.get(boss).prevScale;
+	registry.teleporting.remove(boss);
+
+	if (next == EnemyState::SPAWN_MINIONS) {
+		// Minions are spawned after the state machine ran, see step
+		Necromancer& necroComp = registry.necromancers.get(boss);
+		necroComp.centerPosition = registry.enemyMotions.get(boss).position;
+		necroComp.spawningMinions = true;
+		timers.schedule(boss, TimerKind::RELOAD, registry.reloadTimes.get(boss).reload_ms);
+		next = EnemyState::PURSUING;
+	}
+	finish_behaviour(boss, next);
+}
+
+void AISystem::finish_behaviour(Entity enemy, EnemyState next)
+{
+	Enemy &enemyComp = registry.enemies.get(enemy);
+	enemyComp.acting = false;
+	enemyComp.enemyState = next;
 }
 
 // Do a single shot at the player
-void AISystem::single_shot_enemy(Motion &enemyMotion, Motion &playerMotion, ReloadTime &counter)
+void AISystem::single_shot_enemy(Motion &enemyMotion, Motion &playerMotion)
 {
     vec2 angleVector = normalize(enemyMotion.position - playerMotion.position);
     float angle = atan2(angleVector.y, angleVector.x);
     createProjectile(renderer_arg, enemyMotion.position, angle, false);
-    counter.shoot_rate = shoot_rate;
 };
 
 // Do a spread out shotgun shot at the player
-void AISystem::shotgun_enemy(Motion &enemyMotion, Motion &playerMotion, ReloadTime &counter)
+void AISystem::shotgun_enemy(Motion &enemyMotion, Motion &playerMotion)
 {
     vec2 angleVector = normalize(enemyMotion.position - playerMotion.position);
     float angle = atan2(angleVector.y, angleVector.x);
@@ -613,7 +770,6 @@ void AISystem::shotgun_enemy(Motion &enemyMotion, Motion &playerMotion, ReloadTi
     createProjectile(renderer_arg, enemyMotion.position, angle, false);
 	createProjectile(renderer_arg, enemyMotion.position, angle + shotgun_angle, false);
 	createProjectile(renderer_arg, enemyMotion.position, angle - shotgun_angle, false);
-    counter.shoot_rate = shoot_rate;
 };
 
 // DEPRECATED: Extremely simple chase that goes to the players direction, does the Roomba thing when approaching a wall
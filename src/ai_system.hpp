@@ -2,47 +2,90 @@
 
 #include <vector>
 #include <random>
+#include <unordered_map>
 
 #include "tiny_ecs_registry.hpp"
 #include "common.hpp"
 #include "world_init.hpp"
+#include "pathfinding.hpp"
+#include "path_service.hpp"
+#include "incremental_pathfinding.hpp"
+#include "behaviour_scheduler.hpp"
 
 class AISystem
 {
 	RenderSystem *renderer_arg;
 public:
 	void init(RenderSystem *renderer_arg);
-    void step(float elapsed_ms);
+    void step(float frame_ms);
 
     void spawn_minions(glm::vec2 &position);
 
     void teleport_boss(Entity &enemy, Motion &playerMotion, EnemyState &enemyState);
 
 private:
+    // What an enemy knows about the player this tick
+    struct Perception
+    {
+        float distance = 0.0f;
+        bool lineOfSight = false;
+        bool inAggroRange = false;
+        // Whether the enemy thinks this frame, and how much time its tick covers
+        bool tick = false;
+        float elapsed_ms = 0.0f;
+    };
+
+    // One enemy that thinks this frame, pointers stay valid because no enemy is added or removed during
+    // the state handlers
+    struct EnemyTick
+    {
+        Entity entity;
+        Enemy *enemy;
+        Motion *motion;
+        float elapsed_ms;
+        float distance;
+    };
+
+    struct StateTransition
+    {
+        Enemy *enemy;
+        EnemyState state;
+    };
+
     void simple_chase(float elapsed_ms, Motion &playersMotion);
     void simple_chase_enemy(Entity &curr_entity, Motion &playersMotion);
-    void stop_and_shoot(Entity &enemy, ReloadTime &counter, float elapsed_ms, Motion &playerMotion, bool boss);
-    void single_shot_enemy(Motion &enemyMotion, Motion &playerMotion, ReloadTime &counter);
-    void shotgun_enemy(Motion &enemyMotion, Motion &playerMotion, ReloadTime &counter);
+    BehaviourTask shoot_volley(Entity enemy, Entity playerEntity, bool shotgun);
+    BehaviourTask melee_strike(Entity enemy, Entity playerEntity);
+    BehaviourTask teleport_sequence(Entity boss, Entity playerEntity);
+    void finish_behaviour(Entity enemy, EnemyState next);
+    void single_shot_enemy(Motion &enemyMotion, Motion &playerMotion);
+    void shotgun_enemy(Motion &enemyMotion, Motion &playerMotion);
     void context_chase(Entity &enemy,  Motion &playerMotion);
     void ranged_enemy_pursue(Entity &enemy, float elapsed_ms, Motion &playerMotion, EnemyState &enemyState);
     void boss_enemy_pursue(Entity &enemy, float elapsed_ms, Motion &playerMotion, EnemyState &enemyState);
+    void chase_player(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion);
     void chase_with_a_star(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion);
+    void chase_with_flow_field(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion);
+    void chase_with_planner(Pathfinder &pathfinder, float elapsed_ms, Motion &playerMotion, Motion &enemyMotion);
+    FlowField &flow_field_for(int clearance);
+    void separate_enemies();
     void update_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder &pathfinder);
-    void stop_and_melee(Entity &enemy, MeleeAttack &counter, float elapsed_ms, Motion &playerMotion, Entity &playerEntity);
+    void request_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder &pathfinder);
+    void melee_hit(MeleeAttack &counter, Entity &playerEntity);
+    void run_bucket(EnemyType type, EnemyState state, std::vector<EnemyTick> &bucket, Motion &playerMotion, Entity &playerEntity);
+    void queue_transition(EnemyTick &tick, EnemyState from, EnemyState to);
+    void perceive(Motion &playerMotion, float frame_ms);
+    void perceive_enemy(Entity &enemy, Motion &playerMotion);
+    const Perception &perception_of(Entity &enemy, Motion &playerMotion);
     bool line_of_sight_check(Entity &enemy, Motion &playerMotion);
-    bool line_box_collision(Motion &enemyMotion, Motion &obstacleMotion, vec2 &directionDelta);
     vec2 quadratic_bezier(float t, float max_time);
-    void astar_pathfinding(GridMap& grid, GridNode* startNode, GridNode* endNode, Pathfinder &pathfinder);
-    void reset_grid(GridMap &gridMap);
-    void interpolate_pathfinding(Motion &enemyMotion, Pathfinder &pathfinder, Motion &playerMotion);
+    void interpolate_pathfinding(Motion &enemyMotion, Pathfinder &pathfinder, Motion &playerMotion, float elapsed_ms);
 
     const float rangedEnemySpeed = 125.f;
     const float meleeEnemySpeed = 175.f;
 	float const followingConstant = 0.4f;
 	float const distanceToWalls = 150.0f;
     float const aggroDistance = 400.0f;
-    const float original_ms = 3000;
 	const float take_aim_ms = 500;
 	const float shoot_rate = 500;
     const float obstacleForce = 25.0f;
@@ -50,13 +93,51 @@ private:
     const float minDistanceToPlayer = 80.0f;
     const float meleeDistance = 100.0f;
     const float distanceBetweenEnemies = 30.0f;
-    const float los_increment = 50.0f;
     const float shotgun_angle = M_PI/8.0f;
     const float tp_to_player_range = 300.0f;
     const float minionDistance = 90.0f;
 
-    const int a_star_frame_updates = 100;
-    int a_star_frame = 100;
+    // Crowd separation, bins have to be wider than the spacing between the two biggest enemies
+    const float crowdBinSize = 100.0f;
+    const float separationMargin = 4.0f;
+    const float separationSpeed = 120.0f;
+    std::vector<int> crowdBinStart;
+    std::vector<int> crowdFill;
+    std::vector<int> crowdBinned;
+    std::vector<vec2> crowdPush;
+    std::vector<Motion *> crowdMotions;
+    std::vector<Enemy *> crowdEnemies;
+
+    // Attacks and teleports in progress
+    BehaviourScheduler behaviours;
+
+    // One field towards the player per clearance in use
+    std::vector<FlowField> flow_fields;
+
+    // Filled once at the start of each step, each enemy keeps its index in Enemy::perception
+    std::vector<Perception> perceptions;
+
+    // This frame's ticking enemies by type and state, and the state changes they asked for
+    std::vector<EnemyTick> buckets[(int)EnemyType::COUNT][(int)EnemyState::COUNT];
+    std::vector<StateTransition> transitions;
+    unsigned int ai_frame = 0;
+    float frame_ms = 0.0f;
+    // Part of the world that counts as on screen, see perceive
+    vec2 view_min = {0.0f, 0.0f};
+    vec2 view_max = {0.0f, 0.0f};
+
+    // AI level of detail, see perceive_enemy
+    const float lodScreenMargin = 100.0f;
+    const float lodMidDistance = 1200.0f;
+    const unsigned int lodMidPeriod = 4;
+    const unsigned int lodFarPeriod = 8;
+
+    // Search trees of the enemies using PathMode::INCREMENTAL, by entity id
+    std::unordered_map<unsigned int, MovingTargetPlanner> planners;
+
+    // A* refreshes run on the path service's workers, at most this much search time per frame
+    PathService path_service;
+    const float path_budget_ms = 1.0f;
 
     // C++ random number generator
     std::default_random_engine rng;
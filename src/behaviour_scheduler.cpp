@@ -0,0 +1,77 @@
+// internal
+#include "behaviour_scheduler.hpp"
+
+#include <algorithm>
+
+BehaviourScheduler::~BehaviourScheduler()
+{
+    // The tasks destroy their coroutines, the heap only borrows the handles
+    sleepers.clear();
+    tasks.clear();
+}
+
+void BehaviourScheduler::start(Entity owner, BehaviourTask task)
+{
+    // Finished without ever waiting, nothing to keep
+    if (task.handle.done())
+        return;
+    assert(!running(owner) && "Entity already has a running behaviour");
+    tasks.emplace((unsigned int)owner, std::move(task));
+}
+
+bool BehaviourScheduler::wakes_later(const Sleeper &a, const Sleeper &b)
+{
+    if (a.wake_ms != b.wake_ms)
+        return a.wake_ms > b.wake_ms;
+    return a.order > b.order;
+}
+
+void BehaviourScheduler::wake_at(float wake_ms, std::coroutine_handle<> handle)
+{
+    sleepers.push_back({wake_ms, next_order++, handle});
+    std::push_heap(sleepers.begin(), sleepers.end(), wakes_later);
+}
+
+void BehaviourScheduler::step(float elapsed_ms)
+{
+    now_ms += elapsed_ms;
+
+    // Everything due is taken off the heap first, a behaviour that goes back to sleep while being resumed
+    // only wakes up again on a later frame
+    due.clear();
+    while (!sleepers.empty() && sleepers.front().wake_ms <= now_ms)
+    {
+        std::pop_heap(sleepers.begin(), sleepers.end(), wakes_later);
+        due.push_back(sleepers.back());
+        sleepers.pop_back();
+    }
+    if (due.empty())
+        return;
+
+    for (Sleeper &sleeper : due)
+        sleeper.handle.resume();
+
+    for (auto it = tasks.begin(); it != tasks.end();)
+        it = it->second.handle.done() ? tasks.erase(it) : std::next(it);
+}
+
+void BehaviourScheduler::cancel_unless(const std::function<bool(Entity)> &alive)
+{
+    bool cancelled = false;
+    for (auto it = tasks.begin(); it != tasks.end();)
+    {
+        if (alive(Entity(it->first)))
+        {
+            ++it;
+            continue;
+        }
+        std::coroutine_handle<> handle = it->second.handle;
+        sleepers.erase(std::remove_if(sleepers.begin(), sleepers.end(), [&](const Sleeper &sleeper)
+                                      { return sleeper.handle == handle; }),
+                       sleepers.end());
+        it = tasks.erase(it);
+        cancelled = true;
+    }
+    if (cancelled)
+        std::make_heap(sleepers.begin(), sleepers.end(), wakes_later);
+}
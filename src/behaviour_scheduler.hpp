@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+#include <coroutine>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// A behaviour is a coroutine that runs one multi step action of an enemy, like winding up a swing or
+// taking aim and firing. It starts running as soon as it is called and goes until its first co_await.
+class BehaviourTask
+{
+public:
+    struct promise_type
+    {
+        BehaviourTask get_return_object() { return BehaviourTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        // Stays around once finished so the scheduler can tell it is done before destroying it
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    BehaviourTask(BehaviourTask &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    BehaviourTask(const BehaviourTask &) = delete;
+    BehaviourTask &operator=(const BehaviourTask &) = delete;
+    ~BehaviourTask()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+private:
+    friend class BehaviourScheduler;
+    explicit BehaviourTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Owns the running behaviours, at most one per entity, and wakes them up when their delay is over.
+// Sleeping behaviours sit in a min-heap by wake time, so a frame only touches the ones that are due.
+class BehaviourScheduler
+{
+public:
+    ~BehaviourScheduler();
+
+    struct Sleep
+    {
+        BehaviourScheduler &scheduler;
+        float delay_ms;
+
+        bool await_ready() const { return delay_ms <= 0.0f; }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler.wake_at(scheduler.now_ms + delay_ms, handle); }
+        void await_resume() const {}
+    };
+
+    // co_await scheduler.sleep(ms) inside a behaviour
+    Sleep sleep(float delay_ms) { return {*this, delay_ms}; }
+
+    // Takes over a behaviour that was just started for owner
+    void start(Entity owner, BehaviourTask task);
+
+    // Advances the clock and resumes every behaviour whose delay is over
+    void step(float elapsed_ms);
+
+    // Destroys the behaviours of every owner that isn't alive anymore
+    void cancel_unless(const std::function<bool(Entity)> &alive);
+
+    bool running(Entity owner) const { return tasks.count(owner) > 0; }
+
+private:
+    struct Sleeper
+    {
+        float wake_ms;
+        unsigned int order;
+        std::coroutine_handle<> handle;
+    };
+
+    void wake_at(float wake_ms, std::coroutine_handle<> handle);
+    // Pops from the heap after the earliest wake time, ties go to whoever went to sleep first
+    static bool wakes_later(const Sleeper &a, const Sleeper &b);
+
+    float now_ms = 0.0f;
+    unsigned int next_order = 0;
+    std::vector<Sleeper> sleepers;
+    std::unordered_map<unsigned int, BehaviourTask> tasks;
+    std::vector<Sleeper> due;
+};
@@ -8,12 +8,81 @@
 // stlib
 #include <iostream>
 #include <sstream>
+#include <limits>
 
 Debug debugging;
 MouseGestures mouseGestures;
 CurrLevels currLevels;
 float death_timer_counter_ms = 3000;
 
+// Grid DDA (Amanatides & Woo), steps from cell to cell across whichever boundary the segment reaches first
+bool GridMap::lineOfSight(vec2 from, vec2 to) const
+{
+    if (matrixWidth <= 0 || matrixHeight <= 0)
+        return true;
+
+    vec2 cellSize = vec2(mapWidth, mapHeight) / vec2(matrixWidth, matrixHeight);
+    vec2 start = from / cellSize;
+    vec2 delta = to / cellSize - start;
+    ivec2 cell = cellAt(from);
+    ivec2 last = cellAt(to);
+    ivec2 step = {delta.x > 0 ? 1 : -1, delta.y > 0 ? 1 : -1};
+
+    // Both measured as a fraction of the segment: how far to cross a whole cell, and how far to the next boundary
+    const float never = std::numeric_limits<float>::max();
+    vec2 tDelta = {delta.x != 0 ? abs(1.0f / delta.x) : never, delta.y != 0 ? abs(1.0f / delta.y) : never};
+    vec2 tMax = {
+        delta.x != 0 ? (step.x > 0 ? cell.x + 1 - start.x : start.x - cell.x) * tDelta.x : never,
+        delta.y != 0 ? (step.y > 0 ? cell.y + 1 - start.y : start.y - cell.y) * tDelta.y : never};
+
+    // A segment never touches more cells than this, guards against rounding at the far end
+    int steps = abs(last.x - cell.x) + abs(last.y - cell.y) + 2;
+    for (int i = 0; i < steps; i++)
+    {
+        if (isSolid(cell.x, cell.y))
+            return false;
+        if (cell == last || min(tMax.x, tMax.y) > 1.0f)
+            return true;
+
+        if (tMax.x < tMax.y)
+        {
+            cell.x += step.x;
+            tMax.x += tDelta.x;
+        }
+        else if (tMax.y < tMax.x)
+        {
+            cell.y += step.y;
+            tMax.y += tDelta.y;
+        }
+        else
+        {
+            // Straight through a corner, a wall on either side of it still blocks the view
+            if (isSolid(cell.x + step.x, cell.y) || isSolid(cell.x, cell.y + step.y))
+                return false;
+            cell += step;
+            tMax += tDelta;
+        }
+    }
+    return !isSolid(cell.x, cell.y);
+}
+
+float GridMap::wallDistance(vec2 position) const
+{
+    if (wallDistances.empty() || position.x < 0 || position.y < 0 || position.x >= mapWidth || position.y >= mapHeight)
+        return 0.0f;
+
+    // In cells, relative to the centre of the cell above and to the left
+    vec2 cellSize = vec2(mapWidth, mapHeight) / vec2(matrixWidth, matrixHeight);
+    vec2 local = position / cellSize - 0.5f;
+    ivec2 low = clamp(ivec2(floor(local)), ivec2(0), ivec2(matrixWidth - 1, matrixHeight - 1));
+    ivec2 high = min(low + 1, ivec2(matrixWidth - 1, matrixHeight - 1));
+    vec2 t = clamp(local - vec2(low), vec2(0.0f), vec2(1.0f));
+
+    float top = mix(wallDistances[cellIndex(low)], wallDistances[cellIndex({high.x, low.y})], t.x);
+    float bottom = mix(wallDistances[cellIndex({low.x, high.y})], wallDistances[cellIndex(high)], t.x);
+    return mix(top, bottom, t.y);
+}
+
 // Very, VERY simple OBJ loader from https://github.com/opengl-tutorials/ogl tutorial 7
 // (modified to also read vertex color and omit uv and normals)
 bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<TexturedVertex> &out_vertices, std::vector<uint16_t> &out_vertex_indices, std::vector<uint16_t> &out_uv_indices, vec2 &out_size)
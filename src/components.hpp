@@ -18,13 +18,34 @@ enum class EnemyState
     AVOIDWALL = PURSUING + 1,
     ATTACK = AVOIDWALL + 1,
     TELEPORTING = ATTACK + 1,
-    SPAWN_MINIONS = TELEPORTING + 1
+    SPAWN_MINIONS = TELEPORTING + 1,
+    COUNT = SPAWN_MINIONS + 1
+};
+
+// Which behaviour the AI runs, minions behave like the enemy they are a small version of
+enum class EnemyType
+{
+    MELEE = 0,
+    RANGED = MELEE + 1,
+    COWBOY = RANGED + 1,
+    NECROMANCER = COWBOY + 1,
+    COUNT = NECROMANCER + 1
 };
 
 // anything that is deadly to the player
 struct Enemy
 {
     EnemyState enemyState = EnemyState::PURSUING;
+    EnemyType type = EnemyType::MELEE;
+    // Frame time not yet handed to the AI, far enemies only think every few frames
+    float aiPendingMs = 0.0f;
+    // Velocity the AI chose, before crowd separation is blended in
+    vec2 aiVelocity = {0.0f, 0.0f};
+    // Busy with a behaviour coroutine, the state machine leaves it alone until the behaviour ends
+    bool acting = false;
+    // Where this enemy's perception sits in the AI's list, only valid on the AI frame it was perceived
+    int perception = -1;
+    unsigned int perceivedFrame = 0;
 };
 
 struct Health
@@ -66,11 +87,10 @@ struct LineOfSight
     float ray_width = 300;
 };
 
+// Cooldown before the enemy can start its next ranged attack, counted down by the TimerKind::RELOAD timer
 struct ReloadTime
 {
-    float counter_ms = 3000;
-    float take_aim_ms = 500;
-    float shoot_rate = 500;
+    float reload_ms = 3000;
 };
 
 struct Projectile
@@ -83,14 +103,13 @@ struct Projectile
 struct MeleeAttack
 {
     int damage = 10;
-    float windup = 500;
+    // How long the enemy stands still before the hit lands
     float windupMax = 500;
 };
 
 struct DamageEffect
 {
     bool is_attacked = false;
-    float damage_show_time = 200;
     float max_show_time = 200;
 };
 
@@ -106,7 +125,6 @@ struct Necromancer
 
 struct Teleporter
 {
-    float animation_time = 1000.0f;
     float max_teleport_time = 1000.0f;
     vec2 prevScale = vec2(0.0f, 0.0f);
 };
@@ -128,6 +146,7 @@ enum class PowerUpType
     POWER_UP_COUNT = HEALTH_STEALER + 1
 };
 
+// The timers are durations in seconds, the countdowns run on the timer wheel
 struct PowerUp
 {
     float available_timer = 10.f;
@@ -145,7 +164,6 @@ struct Dash
     float max_dash_charges = 2;
 
     // varying
-    float recharge_timer = 0;
     float charges = max_dash_charges;
     float remaining_dash_time = 0;
     vec2 dash_direction = vec2(0, 1);
@@ -221,6 +239,29 @@ struct TexturedVertex
     vec2 texcoord;
 };
 
+// Per instance data of a batched sprite (sprite_batch.vs.glsl), the mesh itself comes from its geometry
+struct SpriteInstance
+{
+    // Columns of the model transform
+    vec3 transform[3];
+    // Offset and size of the part of the texture that is shown, the first frame for a sprite sheet
+    vec4 uv_rect;
+    vec3 color;
+    // Start time, frame time, frame count and loop flag of the sprite sheet animation, the frame is
+    // picked in sprite_batch.vs.glsl. A single frame for sprites that don't animate.
+    vec4 animation;
+};
+
+// Vertex of the baked walls and floor (level.vs.glsl). Several textures share the level mesh, so
+// every vertex carries the part of the atlas its texture is in.
+struct LevelVertex
+{
+    vec3 position;
+    // In whole textures, anything past 1 repeats the texture
+    vec2 texcoord;
+    vec4 uv_rect;
+};
+
 // Mesh datastructure for storing vertex and index buffers
 struct Mesh
 {
@@ -231,6 +272,7 @@ struct Mesh
     std::vector<uint16_t> uv_indices;
 };
 
+// Lasts timer seconds, see TimerKind::LIGHT_UP
 struct LightUp
 {
     float timer = 2.5f;
@@ -238,14 +280,24 @@ struct LightUp
 
 struct Animation
 {
-    float current_time = 0.f;
+    // Game time in seconds the current run of frames started, the frame shown follows from it
+    float start_time = 0.f;
     float frame_time = 0.2f;
-    int current_frame = 0;
     int num_frames;
     int sprite_width;
     int sprite_height;
+    // A stopped animation stays on its first frame
     bool is_playing = true;
     bool loop = true;
+
+    // Frame shown at game time time in seconds. sprite_batch.vs.glsl works it out the same way for drawing.
+    int frameAt(float time) const
+    {
+        if (!is_playing)
+            return 0;
+        int frame = (int)(max(time - start_time, 0.f) / frame_time);
+        return loop ? frame % num_frames : min(frame, num_frames - 1);
+    }
 };
 
 struct Ray
@@ -265,34 +317,37 @@ struct LineSegment
 // font character structure
 struct Character
 {
-    unsigned int TextureID; // ID handle of the glyph texture
+    vec4 uv_rect;           // Offset and size of the glyph in the glyph atlas
     glm::ivec2 Size;        // Size of glyph
     glm::ivec2 Bearing;     // Offset from baseline to left/top of glyph
     unsigned int Advance;   // Offset to advance to next glyph
-    char character;
 };
 
-struct Text
+// Vertex of the text quads (font.vs.glsl), all text of a frame goes into one buffer
+struct TextVertex
 {
-    std::string text;
     vec2 position;
-    glm::vec3 color;
-    float scale;
-    float timer = 0.2f;
-    bool timed = true;
+    vec2 texcoord;
+    vec3 color;
+};
+
+// A point of the gesture trail, side pushes it out to one edge of the line
+struct GestureVertex
+{
+    vec2 position;
+    float side;
 };
 
-struct TextRenderRequest
+struct Text
 {
     std::string text;
-    float x;
-    float y;
-    float scale;
+    vec2 position;
     glm::vec3 color;
-    glm::mat4 transform;
-
-    TextRenderRequest(std::string t, float px, float py, float s, const glm::vec3 c, const glm::mat4 trans)
-        : text(t), x(px), y(py), scale(s), color(c), transform(trans) {}
+    float scale;
+    // Glyph quads of the text around its baseline origin, only laid out again when text or scale change
+    std::vector<TextVertex> layout;
+    std::string layout_text;
+    float layout_scale = 0.f;
 };
 
 struct Light
@@ -341,10 +396,6 @@ struct GridNode
     ivec2 coord;
     vec2 size;
     bool notWalkable;
-    float gCost;
-    float hCost;
-    float fCost() const { return gCost + hCost; }
-    GridNode *parentNode;
 };
 
 struct GridMap
@@ -355,12 +406,109 @@ struct GridMap
     int mapHeight = window_height_px;
     int matrixWidth = 0;
     int matrixHeight = 0;
+    // Width and height of a WFC tile in cells
+    int tileCells = 5;
+    // Distance in cells from each cell to the nearest wall, see computeClearanceMap
+    std::vector<uint8_t> clearance;
+    // Distance in pixels from each cell's centre to the nearest wall's centre, see computeWallDistanceMap
+    std::vector<float> wallDistances;
+
+    // Cells far enough from every wall and from the edge of the room to spawn in, one list per distance
+    struct SpawnCells
+    {
+        float clearance;
+        std::vector<int> cells;
+    };
+    std::vector<SpawnCells> spawnCells;
+
+    // Anything outside the grid counts as solid so movers can never leave the room
+    bool isSolid(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= matrixWidth || y >= matrixHeight)
+            return true;
+        return gridMap[y][x].notWalkable;
+    }
+
+    // Cells are also addressed by a flat row major index
+    int cellCount() const { return matrixWidth * matrixHeight; }
+    int cellIndex(ivec2 coord) const { return coord.y * matrixWidth + coord.x; }
+    ivec2 cellCoord(int index) const { return {index % matrixWidth, index / matrixWidth}; }
+    vec2 cellCenter(int index) const { return gridMap[index / matrixWidth][index % matrixWidth].position; }
+
+    // Cell containing a world position, clamped to the grid
+    ivec2 cellAt(vec2 position) const
+    {
+        vec2 coord = clamp(position / vec2(mapWidth, mapHeight), vec2(0.0), vec2(0.99));
+        return {(int)floor(coord.x * matrixWidth), (int)floor(coord.y * matrixHeight)};
+    }
+
+    // True when the segment crosses no solid cell. Walks exactly the cells the segment touches.
+    bool lineOfSight(vec2 from, vec2 to) const;
+
+    // Distance from any position to the nearest wall's centre, blended from the four closest cell centres.
+    // Outside the room it is 0.
+    float wallDistance(vec2 position) const;
+};
+
+// Ring of flat cell indices, the front is the next cell to walk to. Popping the front is O(1).
+// The ring grows to fit the longest path it was given and keeps that room, so refreshing a path
+// only allocates when it is longer than any before it.
+struct PathRing
+{
+    static const int initial_capacity = 128;
+    std::vector<uint32_t> cells;
+    int head = 0;
+    int count = 0;
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+    int capacity() const { return (int)cells.size(); }
+    int front() const { return cells[head]; }
+    // i-th cell from the front
+    int at(int i) const { return cells[(head + i) % capacity()]; }
+    void pop_front()
+    {
+        head = (head + 1) % capacity();
+        count--;
+    }
+    void push_back(int cell)
+    {
+        if (count == capacity())
+        {
+            // Unroll the ring into a bigger one, the front moves back to the start
+            std::vector<uint32_t> grown(count == 0 ? initial_capacity : capacity() * 2);
+            for (int i = 0; i < count; i++)
+                grown[i] = cells[(head + i) % capacity()];
+            cells.swap(grown);
+            head = 0;
+        }
+        cells[(head + count) % capacity()] = (uint32_t)cell;
+        count++;
+    }
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+};
+
+enum class PathMode
+{
+    // Own A* search towards the player, refreshed on a timer
+    A_STAR = 0,
+    // Follow the flow field shared by every enemy chasing the player
+    FLOW_FIELD = A_STAR + 1,
+    // Own A* search that keeps its tree between plans, replanning whenever it or the player changes cells
+    INCREMENTAL = FLOW_FIELD + 1
 };
 
 struct Pathfinder
 {
-    std::vector<GridNode *> path;
-    float refresh_rate = 1000.0f;
+    PathMode mode = PathMode::A_STAR;
+    PathRing path;
+    // Cells on the path have to be at least this far from any wall, bigger enemies need more room
+    int clearance = 2;
+    // Time between two A* searches, see TimerKind::PATH_REFRESH
     float max_refresh_rate = 1000.0f;
 };
 
@@ -414,7 +562,8 @@ enum class TEXTURE_ASSET_ID
     PLAYER_HEALTH_BAR = HEALTH_BAR + 1,
     BOSS_ENEMY = PLAYER_HEALTH_BAR + 1,
     NECROMANCER_ENEMY = BOSS_ENEMY + 1,
-    TEXTURE_COUNT = NECROMANCER_ENEMY + 1,
+    FLOOR = NECROMANCER_ENEMY + 1,
+    TEXTURE_COUNT = FLOOR + 1,
 };
 const int texture_count = (int)TEXTURE_ASSET_ID::TEXTURE_COUNT;
 
@@ -423,7 +572,9 @@ enum class EFFECT_ASSET_ID
     TEXTURED = 0,
     WATER = TEXTURED + 1,
     LIGHT = WATER + 1,
-    EFFECT_COUNT = LIGHT + 1
+    SPRITE_BATCH = LIGHT + 1,
+    LEVEL = SPRITE_BATCH + 1,
+    EFFECT_COUNT = LEVEL + 1
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
@@ -435,8 +586,7 @@ enum class GEOMETRY_BUFFER_ID
     PROJECTILE = UI_COMPONENT + 1,
     VISIBILITY_POLYGON = PROJECTILE + 1,
     SHADOW_PLANE = VISIBILITY_POLYGON + 1,
-    FLOOR = SHADOW_PLANE + 1,
-    GEOMETRY_COUNT = FLOOR + 1
+    GEOMETRY_COUNT = SHADOW_PLANE + 1
 };
 
 enum class SCREEN_ID
@@ -0,0 +1,35 @@
+// internal
+#include "floating_text.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+FloatingTextPool floatingTexts;
+
+void FloatingTextPool::spawn(vec2 position, float scale, vec3 color, const char *format, ...)
+{
+    FloatingText &entry = entries[next];
+    next = (next + 1) % CAPACITY;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(entry.text, sizeof(entry.text), format, args);
+    va_end(args);
+    entry.position = position;
+    entry.color = color;
+    entry.scale = scale;
+    entry.remaining_ms = LIFETIME_MS;
+}
+
+void FloatingTextPool::advance(float elapsed_ms)
+{
+    for (FloatingText &entry : entries)
+        entry.remaining_ms -= elapsed_ms;
+}
+
+void FloatingTextPool::clear()
+{
+    for (FloatingText &entry : entries)
+        entry.remaining_ms = 0.f;
+    next = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+
+// A short lived number that pops up over the screen, like the damage taken or health gained
+struct FloatingText
+{
+    char text[16];
+    vec2 position;
+    vec3 color;
+    float scale;
+    float remaining_ms;
+};
+
+// Fixed ring of floating texts. Spawning writes into the next slot, taking over the oldest entry
+// once every slot is in use, so a hit never creates an entity or allocates a string.
+class FloatingTextPool
+{
+public:
+    static const int CAPACITY = 64;
+    // How long a floating text stays on screen
+    static constexpr float LIFETIME_MS = 200.f;
+
+    // The text is formatted printf style and cut off to fit the slot
+    void spawn(vec2 position, float scale, vec3 color, const char *format, ...);
+    // Counts the texts down by elapsed_ms of game time
+    void advance(float elapsed_ms);
+    void clear();
+
+    // Calls fn on every text still on screen
+    template <typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (const FloatingText &entry : entries)
+            if (entry.remaining_ms > 0.f)
+                fn(entry);
+    }
+
+private:
+    std::array<FloatingText, CAPACITY> entries = {};
+    int next = 0;
+};
+
+extern FloatingTextPool floatingTexts;
@@ -0,0 +1,245 @@
+// internal
+#include "hierarchical_pathfinding.hpp"
+#include "pathfinding.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+int AbstractGraph::clusterOf(ivec2 cell) const
+{
+    return (cell.y / clusterSize) * clusterCount.x + cell.x / clusterSize;
+}
+
+static CellBounds cluster_bounds(const GridMap &grid, const AbstractGraph &graph, int cluster)
+{
+    ivec2 min = graph.clusterCoord(cluster) * graph.clusterSize;
+    ivec2 max = glm::min(min + ivec2(graph.clusterSize - 1), ivec2(grid.matrixWidth - 1, grid.matrixHeight - 1));
+    return {min, max};
+}
+
+void AbstractGraph::build(const GridMap &grid, int clearance)
+{
+    this->clearance = clearance;
+    clusterCount = (ivec2(grid.matrixWidth, grid.matrixHeight) + ivec2(clusterSize - 1)) / clusterSize;
+    nodes.clear();
+    paths.clear();
+    clusterNodes.assign(clusterCount.x * clusterCount.y, {});
+
+    std::vector<int> nodeOfCell(grid.cellCount(), -1);
+    auto open = [&](ivec2 cell) { return grid.clearance[grid.cellIndex(cell)] >= clearance; };
+    auto portal = [&](ivec2 cell) {
+        int index = grid.cellIndex(cell);
+        if (nodeOfCell[index] == -1)
+        {
+            nodeOfCell[index] = (int)nodes.size();
+            nodes.push_back({index, clusterOf(cell), {}});
+            clusterNodes[nodes.back().cluster].push_back(nodeOfCell[index]);
+        }
+        return nodeOfCell[index];
+    };
+    // One portal pair in the middle of every open run along a border, linked by a single step
+    auto addEntrances = [&](ivec2 first, ivec2 along, ivec2 across, int length) {
+        int runStart = -1;
+        for (int i = 0; i <= length; i++)
+        {
+            bool passable = i < length && open(first + along * i) && open(first + along * i + across);
+            if (passable && runStart == -1)
+                runStart = i;
+            if (passable || runStart == -1)
+                continue;
+
+            ivec2 middle = first + along * ((runStart + i - 1) / 2);
+            int a = portal(middle);
+            int b = portal(middle + across);
+            nodes[a].edges.push_back({b, 1.0f, -1, false});
+            nodes[b].edges.push_back({a, 1.0f, -1, false});
+            runStart = -1;
+        }
+    };
+
+    for (int cy = 0; cy < clusterCount.y; cy++)
+    {
+        for (int cx = 0; cx < clusterCount.x; cx++)
+        {
+            ivec2 origin = ivec2(cx, cy) * clusterSize;
+            if (cx + 1 < clusterCount.x)
+            {
+                int rows = std::min(clusterSize, grid.matrixHeight - origin.y);
+                addEntrances(origin + ivec2(clusterSize - 1, 0), {0, 1}, {1, 0}, rows);
+            }
+            if (cy + 1 < clusterCount.y)
+            {
+                int columns = std::min(clusterSize, grid.matrixWidth - origin.x);
+                addEntrances(origin + ivec2(0, clusterSize - 1), {1, 0}, {0, 1}, columns);
+            }
+        }
+    }
+
+    // Cache the paths between every pair of portals sharing a cluster, searched inside that cluster only
+    std::vector<int> cells;
+    for (int cluster = 0; cluster < (int)clusterNodes.size(); cluster++)
+    {
+        CellBounds bounds = cluster_bounds(grid, *this, cluster);
+        const std::vector<int> &inside = clusterNodes[cluster];
+        for (size_t i = 0; i < inside.size(); i++)
+        {
+            for (size_t j = i + 1; j < inside.size(); j++)
+            {
+                int a = inside[i];
+                int b = inside[j];
+                if (!astar_search(grid, grid.cellCoord(nodes[a].cell), grid.cellCoord(nodes[b].cell), clearance, bounds, false, cells))
+                    continue;
+                float cost = (float)cells.size() - 1.0f;
+                int path = (int)paths.size();
+                paths.push_back(cells);
+                nodes[a].edges.push_back({b, cost, path, false});
+                nodes[b].edges.push_back({a, cost, path, true});
+            }
+        }
+    }
+}
+
+// Links from the query's start or end into the portals of its cluster
+struct PortalLink
+{
+    int node;
+    float cost;
+    std::vector<int> cells;
+};
+
+// Per thread scratch for the search over the portal graph
+struct AbstractSearch
+{
+    std::vector<PortalLink> startLinks;
+    std::vector<PortalLink> endLinks;
+    std::vector<float> gCost;
+    std::vector<int> parent;
+    std::vector<bool> closed;
+    std::vector<int> cells;
+};
+
+bool hpa_pathfinding(const GridMap &grid, const AbstractGraph &graph, ivec2 start, ivec2 end, int clearance, PathRing &path)
+{
+    if (graph.empty() || clearance != graph.clearance)
+        return astar_pathfinding(grid, start, end, clearance, path);
+
+    int startCluster = graph.clusterOf(start);
+    int endCluster = graph.clusterOf(end);
+    ivec2 clusterGap = abs(graph.clusterCoord(startCluster) - graph.clusterCoord(endCluster));
+    // Short range, a flat search is cheap and gives the exact path
+    if (max(clusterGap.x, clusterGap.y) <= 1)
+        return astar_pathfinding(grid, start, end, clearance, path);
+
+    thread_local AbstractSearch search;
+
+    // Connect the start and end into the graph. The end side uses the same stop-next-to-the-target rule
+    // as the flat search, so portals are searched towards it rather than from it.
+    search.startLinks.clear();
+    search.endLinks.clear();
+    for (int node : graph.clusterNodes[startCluster])
+    {
+        if (astar_search(grid, start, grid.cellCoord(graph.nodes[node].cell), clearance, cluster_bounds(grid, graph, startCluster), false, search.cells))
+            search.startLinks.push_back({node, (float)search.cells.size() - 1.0f, search.cells});
+    }
+    for (int node : graph.clusterNodes[endCluster])
+    {
+        if (astar_search(grid, grid.cellCoord(graph.nodes[node].cell), end, clearance, cluster_bounds(grid, graph, endCluster), true, search.cells))
+            search.endLinks.push_back({node, (float)search.cells.size() - 1.0f, search.cells});
+    }
+    if (search.startLinks.empty() || search.endLinks.empty())
+        return astar_pathfinding(grid, start, end, clearance, path);
+
+    // A* over the portals, with the start and end as two extra nodes at the back
+    int nodeCount = (int)graph.nodes.size();
+    int startNode = nodeCount;
+    int endNode = nodeCount + 1;
+    search.gCost.assign(nodeCount + 2, INFINITY);
+    search.parent.assign(nodeCount + 2, -1);
+    search.closed.assign(nodeCount + 2, false);
+
+    auto heuristic = [&](int node) {
+        if (node >= nodeCount)
+            return 0.0f;
+        return length(vec2(grid.cellCoord(graph.nodes[node].cell) - end));
+    };
+    typedef std::pair<float, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    auto relax = [&](int from, int to, float cost) {
+        float g = search.gCost[from] + cost;
+        if (search.closed[to] || g >= search.gCost[to])
+            return;
+        search.gCost[to] = g;
+        search.parent[to] = from;
+        open.push({g + heuristic(to), to});
+    };
+
+    search.gCost[startNode] = 0.0f;
+    for (const PortalLink &link : search.startLinks)
+        relax(startNode, link.node, link.cost);
+
+    while (!open.empty())
+    {
+        int curr = open.top().second;
+        open.pop();
+        if (search.closed[curr])
+            continue;
+        search.closed[curr] = true;
+        if (curr == endNode)
+            break;
+
+        for (const AbstractGraph::Edge &edge : graph.nodes[curr].edges)
+            relax(curr, edge.to, edge.cost);
+        for (const PortalLink &link : search.endLinks)
+        {
+            if (link.node == curr)
+                relax(curr, endNode, link.cost);
+        }
+    }
+    if (!search.closed[endNode])
+        return astar_pathfinding(grid, start, end, clearance, path);
+
+    std::vector<int> route;
+    for (int node = endNode; node != -1; node = search.parent[node])
+        route.push_back(node);
+    std::reverse(route.begin(), route.end());
+
+    // The whole route is refined, the ring grows to fit it however big the map is.
+    // Every piece starts on the cell the previous one ended on, so its first cell is skipped.
+    path.clear();
+    auto append = [&](const std::vector<int> &cells, bool reversed) {
+        for (size_t i = 1; i < cells.size(); i++)
+            path.push_back(reversed ? cells[cells.size() - 1 - i] : cells[i]);
+    };
+    for (size_t i = 0; i + 1 < route.size(); i++)
+    {
+        int from = route[i];
+        int to = route[i + 1];
+        if (from == startNode)
+        {
+            for (const PortalLink &link : search.startLinks)
+                if (link.node == to)
+                    append(link.cells, false);
+        }
+        else if (to == endNode)
+        {
+            for (const PortalLink &link : search.endLinks)
+                if (link.node == from)
+                    append(link.cells, false);
+        }
+        else
+        {
+            for (const AbstractGraph::Edge &edge : graph.nodes[from].edges)
+            {
+                if (edge.to != to)
+                    continue;
+                if (edge.path == -1)
+                    path.push_back(graph.nodes[to].cell);
+                else
+                    append(graph.paths[edge.path], edge.reversed);
+                break;
+            }
+        }
+    }
+    return true;
+}
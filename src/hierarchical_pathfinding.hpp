@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+
+#include <vector>
+
+// Abstract graph for hierarchical A* (HPA*). The grid is cut into clusters the size of a WFC tile and
+// every open stretch of border between two clusters gets a portal cell on each side. Portals in the
+// same cluster are linked by paths that are searched once when the graph is built and then cached, so
+// a long query only searches the small portal graph and then stitches the cached pieces together.
+struct AbstractGraph
+{
+    struct Edge
+    {
+        int to;
+        float cost;
+        // Cached cell path from this node to the other, -1 for the single step across a cluster border
+        int path;
+        // The cached path is stored from the other end
+        bool reversed;
+    };
+
+    struct Node
+    {
+        int cell;
+        int cluster;
+        std::vector<Edge> edges;
+    };
+
+    // The graph only holds for agents needing exactly this clearance
+    int clearance = 0;
+    int clusterSize = 0;
+    ivec2 clusterCount = {0, 0};
+    std::vector<Node> nodes;
+    // Portal nodes inside each cluster
+    std::vector<std::vector<int>> clusterNodes;
+    std::vector<std::vector<int>> paths;
+
+    void build(const GridMap &grid, int clearance);
+    bool empty() const { return nodes.empty(); }
+    int clusterOf(ivec2 cell) const;
+    ivec2 clusterCoord(int cluster) const { return {cluster % clusterCount.x, cluster / clusterCount.x}; }
+};
+
+// Same contract as astar_pathfinding. Queries between clusters that are next to each other, or for a
+// different clearance than the graph was built for, fall back to a flat search.
+// The cost of going through portals: paths are not shortest paths, they bend through the portal
+// cells and can come out noticeably longer than the flat search would make them.
+bool hpa_pathfinding(const GridMap &grid, const AbstractGraph &graph, ivec2 start, ivec2 end, int clearance, PathRing &path);
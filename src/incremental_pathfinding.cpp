@@ -0,0 +1,215 @@
+// internal
+#include "incremental_pathfinding.hpp"
+
+#include <algorithm>
+
+static const ivec2 directions[8] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}, {1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+
+bool MovingTargetPlanner::plan(const GridMap &grid, unsigned int gridId, ivec2 start, ivec2 goal, int clearance, PathRing &path)
+{
+    int startCell = grid.cellIndex(start);
+    int newGoal = grid.cellIndex(goal);
+    bool stale = gridId != builtForGrid || clearance != this->clearance || rootCell == -1 || (int)tree.stamp.size() < grid.cellCount();
+
+    // Nothing moved, the path the agent is walking is still the best one
+    if (!stale && startCell == rootCell && newGoal == goalCell)
+        return found;
+
+    goalCell = newGoal;
+    goalCoord = goal;
+    if (stale || !isClosed(startCell))
+    {
+        builtForGrid = gridId;
+        this->clearance = clearance;
+        reset(grid, startCell);
+    }
+    else if (startCell != rootCell)
+    {
+        reroot(grid, startCell);
+    }
+    retarget(grid);
+
+    int target = search(grid);
+    found = target != -1;
+    if (!found)
+        return false;
+
+    chain.clear();
+    for (int cell = target; cell != -1; cell = tree.parent[cell])
+        chain.push_back(cell);
+
+    // The last entry is the start cell, leave it out
+    path.clear();
+    for (int i = (int)chain.size() - 2; i >= 0; i--)
+        path.push_back(chain[i]);
+    return true;
+}
+
+// Steps cost the same in all eight directions, so the Chebyshev distance to the ring around the target is
+// exact on an open floor. Keeping it consistent is what lets closed cells stay closed across plans.
+float MovingTargetPlanner::heuristic(const GridMap &grid, int cell) const
+{
+    ivec2 toGoal = abs(goalCoord - grid.cellCoord(cell));
+    return (float)std::max(max(toGoal.x, toGoal.y) - 1, 0);
+}
+
+// Within one block away
+bool MovingTargetPlanner::atGoal(const GridMap &grid, int cell) const
+{
+    ivec2 toGoal = abs(grid.cellCoord(cell) - goalCoord);
+    return max(toGoal.x, toGoal.y) <= 1;
+}
+
+void MovingTargetPlanner::reset(const GridMap &grid, int startCell)
+{
+    tree.begin(grid.cellCount());
+    tree.stamp[startCell] = tree.generation;
+    tree.gCost[startCell] = 0.0f;
+    tree.parent[startCell] = -1;
+    tree.heap.push_back(startCell);
+    tree.heapIndex[startCell] = 0;
+    rootCell = startCell;
+}
+
+void MovingTargetPlanner::reroot(const GridMap &grid, int startCell)
+{
+    int cellCount = grid.cellCount();
+
+    // Find the branch hanging off the new start by walking each cell up towards the old root,
+    // remembering the answer for every cell passed on the way
+    inSubtree.assign(cellCount, -1);
+    inSubtree[startCell] = 1;
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        if (!tree.seen(cell))
+            continue;
+        chain.clear();
+        int up = cell;
+        while (up != -1 && inSubtree[up] == -1)
+        {
+            chain.push_back(up);
+            up = tree.parent[up];
+        }
+        signed char inside = up == -1 ? 0 : inSubtree[up];
+        for (int passed : chain)
+            inSubtree[passed] = inside;
+    }
+
+    // Closed cells in that branch keep their costs, measured from the new start now. A shortest path
+    // through the new start was also a shortest path from it, so they are still exact.
+    float offset = tree.gCost[startCell];
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        if (!tree.seen(cell))
+            continue;
+        if (inSubtree[cell] == 1 && isClosed(cell))
+            tree.gCost[cell] -= offset;
+        else
+            tree.stamp[cell] = 0;
+    }
+    tree.parent[startCell] = -1;
+    rootCell = startCell;
+
+    // The new open list is the fringe around what was kept, each cell costed through its best kept neighbour
+    tree.heap.clear();
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        // Only the kept cells are expanded, the fringe cells pushed below are open and stay put
+        if (!isClosed(cell))
+            continue;
+        ivec2 coord = grid.cellCoord(cell);
+        for (const ivec2 &direction : directions)
+        {
+            ivec2 nextCoord = coord + direction;
+            if (nextCoord.x < 0 || nextCoord.y < 0 || nextCoord.x >= grid.matrixWidth || nextCoord.y >= grid.matrixHeight)
+                continue;
+            int next = grid.cellIndex(nextCoord);
+            if (isClosed(next) || grid.clearance[next] < clearance)
+                continue;
+
+            float gCost = tree.gCost[cell] + 1.0f;
+            if (!tree.seen(next))
+            {
+                tree.stamp[next] = tree.generation;
+                tree.heapIndex[next] = (int)tree.heap.size();
+                tree.heap.push_back(next);
+            }
+            else if (gCost >= tree.gCost[next])
+            {
+                continue;
+            }
+            tree.gCost[next] = gCost;
+            tree.parent[next] = cell;
+        }
+    }
+}
+
+// Costs in the tree don't depend on the target, only the open list's order does
+void MovingTargetPlanner::retarget(const GridMap &grid)
+{
+    for (int cell : tree.heap)
+        tree.fCost[cell] = tree.gCost[cell] + heuristic(grid, cell);
+    tree.reheapify();
+}
+
+int MovingTargetPlanner::search(const GridMap &grid)
+{
+    // The tree may already reach next to the target, then the search only has to rule out anything cheaper
+    int best = -1;
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            ivec2 coord = goalCoord + ivec2(dx, dy);
+            if (coord.x < 0 || coord.y < 0 || coord.x >= grid.matrixWidth || coord.y >= grid.matrixHeight)
+                continue;
+            int cell = grid.cellIndex(coord);
+            if (isClosed(cell) && (best == -1 || tree.gCost[cell] < tree.gCost[best]))
+                best = cell;
+        }
+    }
+
+    while (!tree.heap.empty())
+    {
+        if (best != -1 && tree.fCost[tree.heap[0]] >= tree.gCost[best] + heuristic(grid, best))
+            break;
+
+        // Closed cells are always expanded, even the one that ends the search, so a later plan can grow
+        // the tree from any of them
+        int curr = tree.pop();
+        ivec2 currCoord = grid.cellCoord(curr);
+        for (const ivec2 &direction : directions)
+        {
+            ivec2 nextCoord = currCoord + direction;
+            if (nextCoord.x < 0 || nextCoord.y < 0 || nextCoord.x >= grid.matrixWidth || nextCoord.y >= grid.matrixHeight)
+                continue;
+            int next = grid.cellIndex(nextCoord);
+
+            // Unlike the flat search there is no squeezing past walls next to the target, the tree has to
+            // stay valid for wherever the target goes next
+            if (isClosed(next) || grid.clearance[next] < clearance)
+                continue;
+
+            float gCost = tree.gCost[curr] + 1.0f;
+            bool seen = tree.seen(next);
+            if (seen && gCost >= tree.gCost[next])
+                continue;
+
+            tree.gCost[next] = gCost;
+            tree.fCost[next] = gCost + heuristic(grid, next);
+            tree.parent[next] = curr;
+            if (seen)
+            {
+                tree.decreaseKey(next);
+            }
+            else
+            {
+                tree.stamp[next] = tree.generation;
+                tree.push(next);
+            }
+        }
+        if (atGoal(grid, curr))
+            return curr;
+    }
+    return best;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+#include "pathfinding.hpp"
+
+#include <vector>
+
+// Moving target A* that keeps one agent's search tree between plans, in the spirit of Fringe-Retrieving A*
+// and Moving Target D* Lite. Cells it has already closed keep their exact costs, so:
+// - when only the target moves, the open list is re-sorted for the new target and the search continues
+// - when the agent moves along the tree, the branch under its new cell is kept as the new tree and the
+//   rest is thrown away, then the search continues from the edge of what was kept
+// Only a jump off the tree (a teleport, a new level) starts from scratch.
+class MovingTargetPlanner
+{
+public:
+    // Same contract as astar_pathfinding. Searching only happens when the agent or the target changed cells.
+    bool plan(const GridMap &grid, unsigned int gridId, ivec2 start, ivec2 goal, int clearance, PathRing &path);
+
+private:
+    void reset(const GridMap &grid, int startCell);
+    void reroot(const GridMap &grid, int startCell);
+    void retarget(const GridMap &grid);
+    int search(const GridMap &grid);
+    float heuristic(const GridMap &grid, int cell) const;
+    bool atGoal(const GridMap &grid, int cell) const;
+    bool isClosed(int cell) const { return tree.seen(cell) && tree.heapIndex[cell] == -1; }
+
+    // Owned rather than the shared per-thread context, since the tree has to outlive a single search
+    AStarContext tree;
+    unsigned int builtForGrid = 0;
+    int clearance = 0;
+    int rootCell = -1;
+    int goalCell = -1;
+    ivec2 goalCoord = {0, 0};
+    bool found = false;
+
+    // Scratch for rerooting
+    std::vector<signed char> inSubtree;
+    std::vector<int> chain;
+};
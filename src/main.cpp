@@ -12,6 +12,7 @@
 #include "render_system.hpp"
 #include "world_system.hpp"
 #include "ai_system.hpp"
+#include "timer_wheel.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
@@ -56,13 +57,15 @@ int main()
         bool isPaused = world.isPaused();
         if (!isPaused)
         {
-            world.step(elapsed_ms);
-            physics.step(elapsed_ms);
-            world.handle_collisions(elapsed_ms);
-            aiSystem.step(elapsed_ms);
+            // All game time comes from the timer wheel, so slowing it down slows every system
+            float game_ms = timers.advance(elapsed_ms);
+            world.step(game_ms);
+            physics.step(game_ms);
+            world.handle_collisions(game_ms);
+            aiSystem.step(game_ms);
         }
 
-        renderer.draw(elapsed_ms, isPaused);
+        renderer.draw(isPaused);
     }
 
     // Save game state on close
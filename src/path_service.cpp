@@ -0,0 +1,141 @@
+// internal
+#include "path_service.hpp"
+#include "tiny_ecs_registry.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using PathClock = std::chrono::steady_clock;
+
+// Searches are short, one or two threads is plenty next to the main and physics threads
+const unsigned int MAX_PATH_WORKERS = 2;
+// The hierarchical graph is built for the default enemy clearance, the bosses that use A*
+const int HPA_CLEARANCE = Pathfinder().clearance;
+
+PathService::PathService()
+{
+    unsigned int count = std::max(1u, std::min(MAX_PATH_WORKERS, std::thread::hardware_concurrency() / 4));
+    for (unsigned int i = 0; i < count; i++)
+        workers.emplace_back(&PathService::worker_loop, this);
+}
+
+PathService::~PathService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void PathService::sync_grid()
+{
+    if (registry.gridMaps.size() <= 0)
+    {
+        nav = nullptr;
+        grid_id = 0;
+        return;
+    }
+    unsigned int id = registry.gridMaps.entities[0];
+    if (nav != nullptr && id == grid_id)
+        return;
+
+    std::shared_ptr<NavSnapshot> snapshot = std::make_shared<NavSnapshot>();
+    snapshot->grid = registry.gridMaps.components[0];
+    snapshot->graph.clusterSize = snapshot->grid.tileCells;
+    snapshot->graph.build(snapshot->grid, HPA_CLEARANCE);
+    nav = snapshot;
+    grid_id = id;
+}
+
+bool PathService::find_path(const NavSnapshot &nav, ivec2 start, ivec2 goal, int clearance, PathRing &path)
+{
+    return hpa_pathfinding(nav.grid, nav.graph, start, goal, clearance, path);
+}
+
+bool PathService::find_path_now(ivec2 start, ivec2 goal, int clearance, PathRing &path)
+{
+    if (nav == nullptr)
+        return false;
+    return find_path(*nav, start, goal, clearance, path);
+}
+
+void PathService::request(Entity entity, ivec2 start, ivec2 goal, int clearance, float priority)
+{
+    if (nav == nullptr || !waiting.insert(entity).second)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.push({entity, start, goal, clearance, priority, nav});
+}
+
+void PathService::collect()
+{
+    std::vector<Result> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.swap(results);
+    }
+
+    for (Result &result : finished)
+    {
+        waiting.erase(result.entity);
+        Entity entity = result.entity;
+        if (!result.found || result.nav != nav || !registry.pathfinders.has(entity))
+            continue;
+
+        // The enemy kept moving while the search ran, skip any cells it already walked past
+        if (registry.enemyMotions.has(entity))
+        {
+            const GridMap &grid = nav->grid;
+            int current = grid.cellIndex(grid.cellAt(registry.enemyMotions.get(entity).position));
+            for (int i = 0; i < std::min(result.path.size(), 4); i++)
+            {
+                if (result.path.at(i) != current)
+                    continue;
+                for (int j = 0; j <= i; j++)
+                    result.path.pop_front();
+                break;
+            }
+        }
+        // Swapped rather than copied, the ring can be long on big maps
+        std::swap(registry.pathfinders.get(entity).path, result.path);
+    }
+}
+
+void PathService::start_frame(float budget_ms)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget_us = (long long)(budget_ms * 1000.f);
+    }
+    work_cv.notify_all();
+}
+
+void PathService::worker_loop()
+{
+    while (true)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_cv.wait(lock, [this]() { return stopping || (!requests.empty() && budget_us > 0); });
+            if (stopping)
+                return;
+            request = requests.top();
+            requests.pop();
+        }
+
+        auto start = PathClock::now();
+        Result result;
+        result.entity = request.entity;
+        result.nav = request.nav;
+        result.found = find_path(*request.nav, request.start, request.goal, request.clearance, result.path);
+        budget_us -= std::chrono::duration_cast<std::chrono::microseconds>(PathClock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(result));
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+#include "hierarchical_pathfinding.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Runs A* requests on background threads so a wave of enemies replanning together can't stall a frame.
+// Requests are served closest to the player first and the workers stop picking up new ones once the
+// frame's time budget is used up, the rest wait for the next frame. Finished paths are handed back
+// to their Pathfinder in collect(); until then enemies keep following the path they already have.
+class PathService
+{
+public:
+    PathService();
+    ~PathService();
+
+    // Makes the workers search a private copy of the current grid, so regenerating the level never
+    // pulls the grid out from under a running search. Results for an older grid are thrown away.
+    // The hierarchical graph for long range searches is built alongside the copy, once per level.
+    void sync_grid();
+
+    // Searches right away on the calling thread, for when waiting a frame isn't an option
+    bool find_path_now(ivec2 start, ivec2 goal, int clearance, PathRing &path);
+
+    // Queues a search for entity unless it already has one waiting. Lower priority runs first.
+    void request(Entity entity, ivec2 start, ivec2 goal, int clearance, float priority);
+
+    // Applies every path that finished since the last call
+    void collect();
+
+    // Gives the workers budget_ms of search time for this frame
+    void start_frame(float budget_ms);
+
+private:
+    struct NavSnapshot
+    {
+        GridMap grid;
+        AbstractGraph graph;
+    };
+
+    struct Request
+    {
+        unsigned int entity;
+        ivec2 start;
+        ivec2 goal;
+        int clearance;
+        float priority;
+        std::shared_ptr<const NavSnapshot> nav;
+    };
+
+    struct Result
+    {
+        unsigned int entity;
+        bool found;
+        PathRing path;
+        std::shared_ptr<const NavSnapshot> nav;
+    };
+
+    struct ComparePriority
+    {
+        bool operator()(const Request &a, const Request &b) const
+        {
+            if (a.priority != b.priority)
+                return a.priority > b.priority;
+            return a.entity > b.entity;
+        }
+    };
+
+    void worker_loop();
+
+    static bool find_path(const NavSnapshot &nav, ivec2 start, ivec2 goal, int clearance, PathRing &path);
+
+    std::shared_ptr<const NavSnapshot> nav;
+    unsigned int grid_id = 0;
+    // Entities with a search queued or running, only touched on the main thread
+    std::unordered_set<unsigned int> waiting;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::priority_queue<Request, std::vector<Request>, ComparePriority> requests;
+    std::vector<Result> results;
+    // Search time left this frame in microseconds
+    std::atomic<long long> budget_us{0};
+    bool stopping = false;
+};
@@ -0,0 +1,271 @@
+// internal
+#include "pathfinding.hpp"
+
+#include <algorithm>
+
+// Possible directions
+static const ivec2 directions[8] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}, {1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+
+const uint16_t FlowField::unreachable;
+
+AStarContext &pathfinding_context()
+{
+    thread_local AStarContext context;
+    return context;
+}
+
+void AStarContext::begin(int cellCount)
+{
+    if ((int)stamp.size() < cellCount)
+    {
+        stamp.resize(cellCount, 0);
+        gCost.resize(cellCount);
+        fCost.resize(cellCount);
+        parent.resize(cellCount);
+        heapIndex.resize(cellCount);
+    }
+    heap.clear();
+
+    // Stamps only need clearing once the counter wraps around
+    if (++generation == 0)
+    {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+}
+
+void AStarContext::place(int i, int cell)
+{
+    heap[i] = cell;
+    heapIndex[cell] = i;
+}
+
+void AStarContext::siftUp(int i)
+{
+    int cell = heap[i];
+    while (i > 0)
+    {
+        int up = (i - 1) / 2;
+        if (fCost[heap[up]] <= fCost[cell])
+            break;
+        place(i, heap[up]);
+        i = up;
+    }
+    place(i, cell);
+}
+
+void AStarContext::siftDown(int i)
+{
+    int cell = heap[i];
+    int size = (int)heap.size();
+    while (true)
+    {
+        int child = 2 * i + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && fCost[heap[child + 1]] < fCost[heap[child]])
+            child++;
+        if (fCost[cell] <= fCost[heap[child]])
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, cell);
+}
+
+void AStarContext::push(int cell)
+{
+    heap.push_back(cell);
+    siftUp((int)heap.size() - 1);
+}
+
+int AStarContext::pop()
+{
+    int top = heap[0];
+    int last = heap.back();
+    heap.pop_back();
+    if (!heap.empty())
+    {
+        heap[0] = last;
+        siftDown(0);
+    }
+    heapIndex[top] = -1;
+    return top;
+}
+
+void AStarContext::decreaseKey(int cell)
+{
+    siftUp(heapIndex[cell]);
+}
+
+void AStarContext::reheapify()
+{
+    for (int i = (int)heap.size() / 2 - 1; i >= 0; i--)
+        siftDown(i);
+}
+
+bool is_blocked_for_enemy(const GridMap &grid, ivec2 cell, ivec2 target, int clearance)
+{
+    if (grid.isSolid(cell.x, cell.y))
+        return true;
+
+    ivec2 toTarget = abs(cell - target);
+    if (max(toTarget.x, toTarget.y) == 1)
+        return false;
+
+    return grid.clearance[grid.cellIndex(cell)] < clearance;
+}
+
+// Inspired by https://www.geeksforgeeks.org/a-search-algorithm/
+bool astar_search(const GridMap &grid, ivec2 start, ivec2 end, int clearance, CellBounds bounds, bool nearGoal, std::vector<int> &cells)
+{
+    AStarContext &context = pathfinding_context();
+    context.begin(grid.cellCount());
+
+    int startCell = grid.cellIndex(start);
+    context.stamp[startCell] = context.generation;
+    context.gCost[startCell] = 0.0f;
+    context.fCost[startCell] = length(vec2(end - start));
+    context.parent[startCell] = -1;
+    context.push(startCell);
+
+    while (!context.heap.empty())
+    {
+        int curr = context.pop();
+        ivec2 currCoord = grid.cellCoord(curr);
+
+        // Within one block away, or on the goal itself
+        ivec2 toEnd = abs(currCoord - end);
+        if (nearGoal ? max(toEnd.x, toEnd.y) <= 1 : currCoord == end)
+        {
+            cells.clear();
+            for (int cell = curr; cell != -1; cell = context.parent[cell])
+            {
+                cells.push_back(cell);
+            }
+            std::reverse(cells.begin(), cells.end());
+            return true;
+        }
+
+        for (const ivec2 &direction : directions)
+        {
+            ivec2 nextCoord = currCoord + direction;
+            if (nextCoord.x < bounds.min.x || nextCoord.y < bounds.min.y || nextCoord.x > bounds.max.x || nextCoord.y > bounds.max.y)
+                continue;
+
+            int next = grid.cellIndex(nextCoord);
+            bool seen = context.seen(next);
+            if (seen && context.heapIndex[next] == -1)
+                continue;
+
+            // Avoid walls and previously visited
+            bool blocked = nearGoal ? is_blocked_for_enemy(grid, nextCoord, end, clearance) : grid.clearance[next] < clearance;
+            if (blocked)
+                continue;
+
+            float tempGCost = context.gCost[curr] + 1.0f;
+            if (seen && tempGCost >= context.gCost[next])
+                continue;
+
+            context.gCost[next] = tempGCost;
+            context.fCost[next] = tempGCost + length(vec2(end - nextCoord));
+            context.parent[next] = curr;
+            if (seen)
+            {
+                context.decreaseKey(next);
+            }
+            else
+            {
+                context.stamp[next] = context.generation;
+                context.push(next);
+            }
+        }
+    }
+    return false;
+}
+
+bool astar_pathfinding(const GridMap &grid, ivec2 start, ivec2 end, int clearance, PathRing &path)
+{
+    std::vector<int> &cells = pathfinding_context().pathScratch;
+    CellBounds bounds = {{0, 0}, {grid.matrixWidth - 1, grid.matrixHeight - 1}};
+    if (!astar_search(grid, start, end, clearance, bounds, true, cells))
+        return false;
+
+    // The first entry is the start cell, leave it out
+    path.clear();
+    for (size_t i = 1; i < cells.size(); i++)
+    {
+        path.push_back(cells[i]);
+    }
+    return true;
+}
+
+void FlowField::update(const GridMap &grid, unsigned int gridId, ivec2 target)
+{
+    int target_index = grid.cellIndex(target);
+    if (target_index == targetCell && gridId == builtForGrid && (int)distance.size() == grid.cellCount())
+        return;
+    targetCell = target_index;
+    targetCoord = target;
+    builtForGrid = gridId;
+
+    distance.assign(grid.cellCount(), unreachable);
+    queue.clear();
+    distance[targetCell] = 0;
+    queue.push_back(targetCell);
+
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        int curr = queue[head];
+        ivec2 currCoord = grid.cellCoord(curr);
+        for (const ivec2 &direction : directions)
+        {
+            ivec2 nextCoord = currCoord + direction;
+            if (nextCoord.x < 0 || nextCoord.y < 0 || nextCoord.x >= grid.matrixWidth || nextCoord.y >= grid.matrixHeight)
+                continue;
+            int next = grid.cellIndex(nextCoord);
+            if (distance[next] != unreachable || is_blocked_for_enemy(grid, nextCoord, target, clearance))
+                continue;
+            distance[next] = distance[curr] + 1;
+            queue.push_back(next);
+        }
+    }
+}
+
+int FlowField::nextCell(const GridMap &grid, ivec2 cell, bool &reached) const
+{
+    reached = false;
+    if (distance.empty())
+        return -1;
+
+    uint16_t current = distance[grid.cellIndex(cell)];
+    if (current <= 1)
+    {
+        reached = true;
+        return -1;
+    }
+
+    // Downhill to the lowest neighbour. Cells off the field (pushed up against a wall) still have a
+    // neighbour on it to climb back onto. Ties go to whichever neighbour points closer to the target.
+    int best = -1;
+    uint16_t bestDistance = current;
+    float bestLength = 0.0f;
+    for (const ivec2 &direction : directions)
+    {
+        ivec2 nextCoord = cell + direction;
+        if (nextCoord.x < 0 || nextCoord.y < 0 || nextCoord.x >= grid.matrixWidth || nextCoord.y >= grid.matrixHeight)
+            continue;
+        int next = grid.cellIndex(nextCoord);
+        uint16_t nextDistance = distance[next];
+        if (nextDistance == unreachable)
+            continue;
+        float nextLength = length(vec2(targetCoord - nextCoord));
+        if (nextDistance < bestDistance || (nextDistance == bestDistance && best != -1 && nextLength < bestLength))
+        {
+            best = next;
+            bestDistance = nextDistance;
+            bestLength = nextLength;
+        }
+    }
+    return best;
+}
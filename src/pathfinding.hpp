@@ -0,0 +1,87 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+
+#include <vector>
+
+// Scratch memory for grid searches. Every search bumps the generation and a cell only counts as
+// seen when its stamp matches, so nothing has to be cleared between searches.
+// Each thread gets its own context through pathfinding_context().
+struct AStarContext
+{
+    std::vector<unsigned int> stamp;
+    std::vector<float> gCost;
+    std::vector<float> fCost;
+    std::vector<int> parent;
+    // Position of the cell in the open heap, or -1 once it is closed
+    std::vector<int> heapIndex;
+    // Binary min heap of cells ordered by fCost
+    std::vector<int> heap;
+    std::vector<int> pathScratch;
+    unsigned int generation = 0;
+
+    // Starts a new search over a grid with cellCount cells
+    void begin(int cellCount);
+    bool seen(int cell) const { return stamp[cell] == generation; }
+
+    void push(int cell);
+    int pop();
+    void decreaseKey(int cell);
+    // Restores the heap order after the fCost of many open cells changed at once
+    void reheapify();
+
+private:
+    void siftUp(int i);
+    void siftDown(int i);
+    void place(int i, int cell);
+};
+
+AStarContext &pathfinding_context();
+
+// Enemies keep their clearance from walls, except when the cell is right next to their target
+bool is_blocked_for_enemy(const GridMap &grid, ivec2 cell, ivec2 target, int clearance);
+
+// Cells a search may enter, both corners included
+struct CellBounds
+{
+    ivec2 min;
+    ivec2 max;
+};
+
+// A* core shared by the flat and hierarchical searches. With nearGoal the search stops within one cell
+// of end and may squeeze past the clearance rule right next to it, otherwise it has to land on end
+// exactly and every cell needs the full clearance. On success cells runs from start to the last cell.
+bool astar_search(const GridMap &grid, ivec2 start, ivec2 end, int clearance, CellBounds bounds, bool nearGoal, std::vector<int> &cells);
+
+// A star over the grid from start to end (cell coordinates), 8 way movement with unit cost, only
+// through cells with at least the given clearance.
+// The search stops once it is within one cell of end, and the start cell is left out of the path
+// to prevent jittering. Returns false and leaves path untouched if end can't be reached.
+bool astar_pathfinding(const GridMap &grid, ivec2 start, ivec2 end, int clearance, PathRing &path);
+
+// Breadth first distance map out from one target cell. Every enemy chasing the same target reads its next
+// step from here, so the cost is one pass over the grid whenever the target changes cells instead of
+// one search per enemy.
+struct FlowField
+{
+    static const uint16_t unreachable = 0xFFFF;
+
+    // Cells on the field need at least this much clearance, as with A*
+    int clearance = 2;
+    // Steps from each cell to the target
+    std::vector<uint16_t> distance;
+
+    // Rebuilds the field if the target moved to another cell or the grid was replaced
+    void update(const GridMap &grid, unsigned int gridId, ivec2 target);
+
+    // Cell to move towards from cell, or -1 if there is none.
+    // reached is set when cell is already within one cell of the target.
+    int nextCell(const GridMap &grid, ivec2 cell, bool &reached) const;
+
+private:
+    int targetCell = -1;
+    unsigned int builtForGrid = 0;
+    ivec2 targetCoord = {0, 0};
+    std::vector<int> queue;
+};
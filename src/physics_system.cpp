@@ -3,9 +3,18 @@
 #include "common.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "timer_wheel.hpp"
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 
+// Number of times a blocked move is allowed to slide before the rest of it is dropped
+const int MAX_SLIDE_ITERATIONS = 4;
+// Gap kept between a mover and the wall it is resting against
+const float SLIDE_SKIN_WIDTH = 0.1f;
+// Narrowphase work is cut into a few chunks per thread so one busy chunk doesn't hold everyone up
+const int NARROWPHASE_CHUNKS_PER_THREAD = 4;
+
 // Returns the local bounding coordinates scaled by the current size of the entity
 vec2 get_bounding_box(const Motion& motion)
 {
@@ -57,6 +66,83 @@ bool PhysicsSystem::collides(const Motion& motion1, const Motion& motion2)
     return motion1_right > motion2_left && motion2_up < motion1_down && motion1_left < motion2_right && motion1_up < motion2_down;
 }
 
+vec2 PhysicsSystem::moveAndSlide(Motion& motion, vec2 move, const GridMap& grid)
+{
+    vec2 start = motion.position;
+    vec2 halfSize = get_bounding_box(motion) / 2.f;
+    vec2 cellSize = vec2(grid.mapWidth / (float)grid.matrixWidth, grid.mapHeight / (float)grid.matrixHeight);
+
+    for (int i = 0; i < MAX_SLIDE_ITERATIONS && dot(move, move) > 1e-8f; i++)
+    {
+        vec2 pos = motion.position;
+
+        // Only the cells touched by the box over the whole move can stop it, which is what keeps
+        // long dashes from tunnelling through a wall in a single frame
+        vec2 sweepMin = min(pos, pos + move) - halfSize;
+        vec2 sweepMax = max(pos, pos + move) + halfSize;
+        ivec2 cellMin = ivec2(floor(sweepMin / cellSize));
+        ivec2 cellMax = ivec2(floor(sweepMax / cellSize));
+
+        float hitTime = 1.f;
+        vec2 hitNormal = vec2(0, 0);
+        for (int y = cellMin.y; y <= cellMax.y; y++)
+        {
+            for (int x = cellMin.x; x <= cellMax.x; x++)
+            {
+                if (!grid.isSolid(x, y))
+                    continue;
+
+                // Grow the cell by the mover's half size so the sweep becomes a ray cast
+                vec2 wallMin = vec2(x, y) * cellSize - halfSize;
+                vec2 wallMax = vec2(x + 1, y + 1) * cellSize + halfSize;
+
+                float entry = -INFINITY;
+                float exit = INFINITY;
+                vec2 normal = vec2(0, 0);
+                bool miss = false;
+                for (int axis = 0; axis < 2; axis++)
+                {
+                    if (move[axis] == 0.f)
+                    {
+                        if (pos[axis] <= wallMin[axis] || pos[axis] >= wallMax[axis])
+                            miss = true;
+                        continue;
+                    }
+                    float t1 = (wallMin[axis] - pos[axis]) / move[axis];
+                    float t2 = (wallMax[axis] - pos[axis]) / move[axis];
+                    if (t1 > t2)
+                        std::swap(t1, t2);
+                    if (t1 > entry)
+                    {
+                        entry = t1;
+                        normal = vec2(0, 0);
+                        normal[axis] = move[axis] > 0 ? -1.f : 1.f;
+                    }
+                    exit = min(exit, t2);
+                }
+
+                // Boxes that already overlap the mover are ignored so it can always back out of them
+                if (miss || entry > exit || entry < 0.f || entry >= hitTime)
+                    continue;
+                hitTime = entry;
+                hitNormal = normal;
+            }
+        }
+
+        if (hitTime >= 1.f)
+        {
+            motion.position = pos + move;
+            break;
+        }
+
+        motion.position = pos + move * hitTime + hitNormal * SLIDE_SKIN_WIDTH;
+        move *= 1.f - hitTime;
+        move -= dot(move, hitNormal) * hitNormal;
+    }
+
+    return motion.position - start;
+}
+
 void PhysicsSystem::step(float elapsed_ms)
 {
 	// Move fish based on how much time has passed, this is to (partially) avoid
@@ -66,6 +152,17 @@ void PhysicsSystem::step(float elapsed_ms)
 
     Entity playerEntity = registry.players.entities[0];
 
+	// The player and enemies are moved through the tile grid so walls stop them during the move itself
+	const GridMap* grid = registry.gridMaps.size() > 0 ? &registry.gridMaps.components[0] : nullptr;
+
+	// Once the cooldown after the last dash is over every charge is back
+	for (Entity entity : timers.expired(TimerKind::DASH_RECHARGE)) {
+		if (registry.dashes.has(entity)) {
+			Dash& dash = registry.dashes.get(entity);
+			dash.charges = dash.max_dash_charges;
+		}
+	}
+
 	for(uint i = 0; i< motion_registry.size(); i++)
 	{
 		Motion& motion = motion_registry.components[i];
@@ -82,16 +179,14 @@ void PhysicsSystem::step(float elapsed_ms)
 				motion.last_physic_move += dash.dash_direction * dash.remaining_dash_time * dash.intial_velocity * step_seconds;
 				dash.remaining_dash_time -= step_seconds;
 			}
-			if (dash.charges != dash.max_dash_charges) {
-				dash.recharge_timer -= step_seconds;
-				if (dash.recharge_timer <= 0) {
-					dash.charges++;
-				}
-			}
 		}
 
 		motion.last_physic_move += motion.velocity * step_seconds;	
-		motion.position += motion.last_physic_move;
+		if (isPlayerEntity && grid != nullptr) {
+			motion.last_physic_move = moveAndSlide(motion, motion.last_physic_move, *grid);
+		} else {
+			motion.position += motion.last_physic_move;
+		}
 	}
 
     for (Motion& projectileMotion : registry.projectileMotions.components) {
@@ -103,107 +198,89 @@ void PhysicsSystem::step(float elapsed_ms)
     for (Motion& enemyMotion : registry.enemyMotions.components) {
 		enemyMotion.last_physic_move = vec2(0,0);
 		enemyMotion.last_physic_move += enemyMotion.velocity * step_seconds;	
-		enemyMotion.position += enemyMotion.last_physic_move;
+		if (grid != nullptr) {
+			enemyMotion.last_physic_move = moveAndSlide(enemyMotion, enemyMotion.last_physic_move, *grid);
+		} else {
+			enemyMotion.position += enemyMotion.last_physic_move;
+		}
     }
 
 	// Check for collisions between all moving entities
-    ComponentContainer<Motion> &motion_container = registry.motions;
     Motion& playerMotion = registry.motions.get(registry.players.entities[0]);
 
-    //Wall collisions
-	for(Motion& wallMotion : registry.wallMotions.components)
-	{
-        //Player motion
-        if (collides(playerMotion, wallMotion)) {
-            registry.collisions.emplace_with_duplicates(wallMotion.entity, playerMotion.entity);
-            registry.collisions.emplace_with_duplicates(playerMotion.entity, wallMotion.entity);
+    // Every moving collider becomes one batch of pair tests. They are gathered on the main thread
+    // so the workers never have to do registry lookups.
+    narrowphaseBatches.clear();
+    for (Motion& projectileMotion : registry.projectileMotions.components) {
+        const Mesh* mesh = registry.meshPtrs.get(projectileMotion.entity);
+        narrowphaseBatches.push_back({ &projectileMotion, &mesh->vertices, NarrowphaseBatch::PROJECTILE });
+    }
+    for (Motion& enemyMotion : registry.enemyMotions.components) {
+        narrowphaseBatches.push_back({ &enemyMotion, nullptr, NarrowphaseBatch::ENEMY });
+    }
+    for (Entity& e : registry.powerUps.entities) {
+        narrowphaseBatches.push_back({ &registry.motions.get(e), nullptr, NarrowphaseBatch::POWER_UP });
+    }
 
+    // Batches are split into contiguous chunks that each fill their own contact buffer. Merging the
+    // buffers in chunk order gives the same collisions in the same order however many threads ran.
+    int chunkCount = std::min((int)narrowphaseBatches.size(), (int)threadPool.size() * NARROWPHASE_CHUNKS_PER_THREAD);
+    if ((int)contactBuffers.size() < chunkCount) {
+        contactBuffers.resize(chunkCount);
+    }
+    threadPool.parallel_for(chunkCount, [&](int chunk) {
+        std::vector<Contact>& contacts = contactBuffers[chunk];
+        contacts.clear();
+        size_t begin = narrowphaseBatches.size() * chunk / chunkCount;
+        size_t end = narrowphaseBatches.size() * (chunk + 1) / chunkCount;
+        for (size_t i = begin; i < end; i++) {
+            runNarrowphase(narrowphaseBatches[i], playerMotion, contacts);
         }
+    });
 
-		for(Motion& projectileMotion : registry.projectileMotions.components)
-		{
-			if (collides(projectileMotion, wallMotion))
-			{
-                const std::vector<TexturedVertex> meshVertices = registry.meshPtrs.get(projectileMotion.entity)->vertices;
-                if (!doesMeshCollide(projectileMotion, meshVertices, wallMotion)) {
-                    continue;
-                }
-
-				// Create a collisions event
-				// We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
-				registry.collisions.emplace_with_duplicates(projectileMotion.entity, wallMotion.entity);
-				registry.collisions.emplace_with_duplicates(wallMotion.entity, projectileMotion.entity);
-			}
-		}
-
-		for(Motion& enemyMotion : registry.enemyMotions.components)
-		{
-			if (collides(enemyMotion, wallMotion))
-			{
-				// Create a collisions event
-				// We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
-				registry.collisions.emplace_with_duplicates(enemyMotion.entity, wallMotion.entity);
-				registry.collisions.emplace_with_duplicates(wallMotion.entity, enemyMotion.entity);
-			}
-		}
-	}
-
-	for(Motion& enemyMotion : registry.enemyMotions.components)
-	{
-        //Player motion
-        if (collides(enemyMotion, playerMotion)) {
-            registry.collisions.emplace_with_duplicates(enemyMotion.entity, playerMotion.entity);
-            registry.collisions.emplace_with_duplicates(playerMotion.entity, enemyMotion.entity);
-
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        for (Contact& contact : contactBuffers[chunk]) {
+            // We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
+            registry.collisions.emplace_with_duplicates(contact.first, contact.second);
+            registry.collisions.emplace_with_duplicates(contact.second, contact.first);
         }
-        for (Motion& enemyMotion2 : registry.enemyMotions.components) {
-            if (enemyMotion.entity == enemyMotion2.entity) continue;
-
-            if (collides(enemyMotion, enemyMotion2)) {
-                registry.collisions.emplace_with_duplicates(enemyMotion.entity, enemyMotion2.entity);
-                registry.collisions.emplace_with_duplicates(enemyMotion2.entity, enemyMotion.entity);
+    }
+}
 
+// Runs on the worker threads, so it may only read motions and write into its own contact buffer
+void PhysicsSystem::runNarrowphase(const NarrowphaseBatch& batch, const Motion& playerMotion, std::vector<Contact>& contacts)
+{
+    const Motion& motion = *batch.motion;
+
+    switch (batch.type) {
+    case NarrowphaseBatch::PROJECTILE:
+        //Wall collisions, the player and enemies never overlap walls so only projectiles are checked
+        for (const Motion& wallMotion : registry.wallMotions.components) {
+            if (collides(motion, wallMotion) && doesMeshCollide(motion, *batch.meshVertices, wallMotion)) {
+                contacts.push_back({ motion.entity, wallMotion.entity });
             }
         }
-
-		for(Motion& projectileMotion : registry.projectileMotions.components)
-		{
-			if (collides(projectileMotion, enemyMotion))
-			{
-                const std::vector<TexturedVertex> meshVertices = registry.meshPtrs.get(projectileMotion.entity)->vertices;
-                if (!doesMeshCollide(projectileMotion, meshVertices, enemyMotion)) {
-                    continue;
-                }
-				// Create a collisions event
-				// We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
-				registry.collisions.emplace_with_duplicates(projectileMotion.entity, enemyMotion.entity);
-				registry.collisions.emplace_with_duplicates(enemyMotion.entity, projectileMotion.entity);
-			}
-		}
-	}
-
-    for(Motion& projectileMotion : registry.projectileMotions.components)
-    {
-        if (collides(projectileMotion, playerMotion))
-        {
-            const std::vector<TexturedVertex> meshVertices = registry.meshPtrs.get(projectileMotion.entity)->vertices;
-            if (!doesMeshCollide(projectileMotion, meshVertices, playerMotion)) {
-                continue;
+        for (const Motion& enemyMotion : registry.enemyMotions.components) {
+            if (collides(motion, enemyMotion) && doesMeshCollide(motion, *batch.meshVertices, enemyMotion)) {
+                contacts.push_back({ motion.entity, enemyMotion.entity });
             }
-
-            // Create a collisions event
-            // We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
-            registry.collisions.emplace_with_duplicates(projectileMotion.entity, playerMotion.entity);
-            registry.collisions.emplace_with_duplicates(playerMotion.entity, projectileMotion.entity);
         }
-	}
+        if (collides(motion, playerMotion) && doesMeshCollide(motion, *batch.meshVertices, playerMotion)) {
+            contacts.push_back({ motion.entity, playerMotion.entity });
+        }
+        break;
 
-    for (Entity& e: registry.powerUps.entities) {
-        Motion& powerUpMotion = registry.motions.get(e);
-        if (collides(powerUpMotion, playerMotion)) {
-            registry.collisions.emplace_with_duplicates(powerUpMotion.entity, playerMotion.entity);
-            registry.collisions.emplace_with_duplicates(playerMotion.entity, powerUpMotion.entity);
+    case NarrowphaseBatch::ENEMY:
+        // Enemies keep apart through the AI's crowd separation, so only the player is tested here
+        if (collides(motion, playerMotion)) {
+            contacts.push_back({ motion.entity, playerMotion.entity });
+        }
+        break;
 
+    case NarrowphaseBatch::POWER_UP:
+        if (collides(motion, playerMotion)) {
+            contacts.push_back({ motion.entity, playerMotion.entity });
         }
+        break;
     }
 }
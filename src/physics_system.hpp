@@ -2,6 +2,9 @@
 
 #include "common.hpp"
 #include "components.hpp"
+#include "thread_pool.hpp"
+
+#include <vector>
 
 // A simple physics system that moves rigid bodies and checks for collision
 class PhysicsSystem
@@ -10,6 +13,10 @@ public:
 	static bool collides(const Motion& motion1, const Motion& motion2);
 	void step(float elapsed_ms);
 
+    // Sweeps the motion's bounding box through the tile grid and slides it along any walls it hits.
+    // Returns the displacement that was actually applied.
+    static vec2 moveAndSlide(Motion& motion, vec2 move, const GridMap& grid);
+
     vec2 calculateVertexPos(const Motion& motion, const TexturedVertex& tv);
 
     bool doesMeshCollide(const Motion& meshMotion, const std::vector<TexturedVertex>& meshVertices, const Motion& otherMotion);
@@ -20,4 +27,25 @@ public:
 	{
 	}
 
+private:
+    // All the pair tests for one moving collider against everything it can hit
+    struct NarrowphaseBatch
+    {
+        const Motion* motion;
+        const std::vector<TexturedVertex>* meshVertices;
+        enum { PROJECTILE, ENEMY, POWER_UP } type;
+    };
+
+    struct Contact
+    {
+        Entity first;
+        Entity second;
+    };
+
+    void runNarrowphase(const NarrowphaseBatch& batch, const Motion& playerMotion, std::vector<Contact>& contacts);
+
+    ThreadPool threadPool;
+    std::vector<NarrowphaseBatch> narrowphaseBatches;
+    // One buffer per chunk of batches, kept between frames to avoid reallocating
+    std::vector<std::vector<Contact>> contactBuffers;
 };
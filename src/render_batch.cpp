@@ -0,0 +1,326 @@
+// internal
+#include "render_system.hpp"
+
+#include "common.hpp"
+#include "components.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "timer_wheel.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+// Sprites are not drawn one by one, they are queued with a sort key and drawn once the queue is flushed.
+// The key puts the layer first so things on top stay on top, then the GL state the sprite needs
+// (effect, atlas page, geometry) and the depth inside the layer last. After sorting, every run of
+// sprites that needs the same state is one instanced draw call, and a state is only bound when it
+// differs from the one already bound.
+
+// Bit layout of the sort key, from the least significant end
+const int SORT_KEY_DEPTH_BITS = 24;
+const int SORT_KEY_GEOMETRY_SHIFT = SORT_KEY_DEPTH_BITS;
+const int SORT_KEY_PAGE_SHIFT = SORT_KEY_GEOMETRY_SHIFT + 8;
+const int SORT_KEY_EFFECT_SHIFT = SORT_KEY_PAGE_SHIFT + 16;
+const int SORT_KEY_LAYER_SHIFT = SORT_KEY_EFFECT_SHIFT + 8;
+
+// Maps a float to an unsigned int with the same ordering, so depths can be radix sorted
+static uint32_t sortableDepth(float depth)
+{
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	return bits >> (32 - SORT_KEY_DEPTH_BITS);
+}
+
+void RenderSystem::initSpriteBatching()
+{
+	glGenVertexArrays((GLsizei)sprite_vaos.size(), sprite_vaos.data());
+
+	// One VAO per geometry, the instance attributes are pointed at the run being drawn every flush
+	for (uint i = 0; i < geometry_count; i++)
+	{
+		if (!isTexturedGeometry((GEOMETRY_BUFFER_ID)i))
+			continue;
+		glBindVertexArray(sprite_vaos[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[i]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[i]);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
+
+		// Locations 2-7 as in sprite_batch.vs.glsl, advancing once per instance
+		for (GLuint attrib = 2; attrib <= 7; attrib++)
+		{
+			glEnableVertexAttribArray(attrib);
+			glVertexAttribDivisor(attrib, 1);
+		}
+	}
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_has_errors();
+}
+
+void RenderSystem::resetStateCache()
+{
+	bound_program = UNKNOWN_BINDING;
+	bound_texture = UNKNOWN_BINDING;
+	bound_vertex_array = UNKNOWN_BINDING;
+	bound_array_buffer = UNKNOWN_BINDING;
+	frame_stats = RenderStats();
+}
+
+GLint RenderSystem::streamUpload(const void *data, size_t count, size_t stride)
+{
+	bindArrayBuffer(stream_buffer.buffer());
+	GLintptr offset = stream_buffer.upload(data, (GLsizeiptr)(count * stride), (GLsizeiptr)stride);
+	gl_has_errors();
+	if (offset < 0)
+	{
+		frame_stats.dropped_uploads++;
+		return -1;
+	}
+	return (GLint)(offset / stride);
+}
+
+void RenderSystem::useProgram(GLuint program)
+{
+	if (program == bound_program)
+		return;
+	glUseProgram(program);
+	bound_program = program;
+	frame_stats.program_binds++;
+}
+
+// Only texture unit 0 is ever used while drawing
+void RenderSystem::bindTexture(GLuint texture)
+{
+	if (texture == bound_texture)
+		return;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	bound_texture = texture;
+	frame_stats.texture_binds++;
+}
+
+void RenderSystem::bindVertexArray(GLuint vertex_array)
+{
+	if (vertex_array == bound_vertex_array)
+		return;
+	glBindVertexArray(vertex_array);
+	bound_vertex_array = vertex_array;
+	frame_stats.buffer_binds++;
+}
+
+void RenderSystem::bindArrayBuffer(GLuint buffer)
+{
+	if (buffer == bound_array_buffer)
+		return;
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	bound_array_buffer = buffer;
+	frame_stats.buffer_binds++;
+}
+
+const Motion &RenderSystem::getEntityMotion(Entity entity)
+{
+	if (registry.enemyMotions.has(entity))
+		return registry.enemyMotions.get(entity);
+	if (registry.wallMotions.has(entity))
+		return registry.wallMotions.get(entity);
+	if (registry.projectileMotions.has(entity))
+		return registry.projectileMotions.get(entity);
+	return registry.motions.get(entity);
+}
+
+mat3 RenderSystem::getEntityTransform(Entity entity)
+{
+	const Motion &motion = getEntityMotion(entity);
+	Transform transform;
+	transform.translate(motion.position);
+
+	// Sprites face left, flip the ones looking right so they don't end up upside down
+	if (fabsf(motion.angle) < (M_PI/2) && !(registry.projectiles.has(entity))) {
+		transform.rotate(motion.angle - M_PI);
+		transform.scale(vec2(-motion.scale.x, motion.scale.y));
+	}
+	else {
+		transform.rotate(motion.angle);
+		transform.scale(motion.scale);
+	}
+	return transform.mat;
+}
+
+RenderSystem::RENDER_LAYER RenderSystem::getRenderLayer(Entity entity)
+{
+	if (registry.powerUps.has(entity))
+		return RENDER_LAYER::PICKUPS;
+	if (registry.projectileMotions.has(entity))
+		return RENDER_LAYER::PROJECTILES;
+	if (registry.healthBars.has(entity))
+		return RENDER_LAYER::OVERLAY;
+	return RENDER_LAYER::ACTORS;
+}
+
+void RenderSystem::queueVisibleSprites()
+{
+	vec2 top_left, bottom_right;
+	getViewRect(top_left, bottom_right);
+
+	for (Entity entity : registry.renderRequests.entities)
+	{
+		// Walls are part of the level mesh, the player is queued on its own after the lighting
+		if (registry.clickables.has(entity) || registry.players.has(entity) || entity == hoverEntity || registry.walls.has(entity))
+			continue;
+
+		// Box around the sprite as it is rotated
+		const Motion &motion = getEntityMotion(entity);
+		vec2 half_size = abs(motion.scale) / 2.f;
+		float c = fabsf(cosf(motion.angle));
+		float s = fabsf(sinf(motion.angle));
+		vec2 half_extent = vec2(c * half_size.x + s * half_size.y, s * half_size.x + c * half_size.y);
+		vec2 sprite_min = motion.position - half_extent;
+		vec2 sprite_max = motion.position + half_extent;
+		if (sprite_max.x < top_left.x || sprite_min.x > bottom_right.x ||
+			sprite_max.y < top_left.y || sprite_min.y > bottom_right.y)
+		{
+			frame_stats.sprites_culled++;
+			continue;
+		}
+		queueSprite(entity);
+		frame_stats.sprites_drawn++;
+	}
+}
+
+void RenderSystem::queueSprite(Entity entity)
+{
+	assert(registry.renderRequests.has(entity));
+	const RenderRequest &render_request = registry.renderRequests.get(entity);
+	assert(render_request.used_effect == EFFECT_ASSET_ID::TEXTURED && "Type of render request not supported");
+	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+
+	const Motion &motion = getEntityMotion(entity);
+	const GLuint used_texture = (GLuint)render_request.used_texture;
+	// Lower on the screen is in front
+	DrawItem item;
+	item.key = ((uint64_t)getRenderLayer(entity) << SORT_KEY_LAYER_SHIFT) |
+			   ((uint64_t)render_request.used_effect << SORT_KEY_EFFECT_SHIFT) |
+			   ((uint64_t)texture_pages[used_texture] << SORT_KEY_PAGE_SHIFT) |
+			   ((uint64_t)render_request.used_geometry << SORT_KEY_GEOMETRY_SHIFT) |
+			   sortableDepth(motion.position.y);
+	item.instance = (uint32_t)queued_instances.size();
+	draw_queue.push_back(item);
+
+	SpriteInstance instance;
+	mat3 transform = getEntityTransform(entity);
+	instance.transform[0] = transform[0];
+	instance.transform[1] = transform[1];
+	instance.transform[2] = transform[2];
+	const vec4 &texture_rect = texture_uv_rects[used_texture];
+	instance.uv_rect = texture_rect;
+	instance.animation = vec4(0.f, 1.f, 1.f, 0.f);
+	if (registry.animations.has(entity))
+	{
+		// The first frame of the sprite sheet, the shader steps along to the current one
+		const Animation &anim = registry.animations.get(entity);
+		const ivec2 &tex_size = texture_dimensions[used_texture];
+		instance.uv_rect.z = float(anim.sprite_width) / tex_size.x * texture_rect.z;
+		if (anim.is_playing)
+			instance.animation = vec4(anim.start_time, anim.frame_time, (float)anim.num_frames, anim.loop ? 1.f : 0.f);
+	}
+	instance.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+	queued_instances.push_back(instance);
+}
+
+// Least significant byte first radix sort. Every pass is stable so sprites with the same key keep
+// the order they were queued in, and bytes that are the same in every key are skipped.
+void RenderSystem::sortDrawQueue()
+{
+	const size_t count = draw_queue.size();
+	if (count < 2)
+		return;
+
+	static uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (const DrawItem &item : draw_queue)
+		for (int digit = 0; digit < 8; digit++)
+			histograms[digit][(item.key >> (digit * 8)) & 0xFF]++;
+
+	draw_queue_scratch.resize(count);
+	for (int digit = 0; digit < 8; digit++)
+	{
+		uint32_t *histogram = histograms[digit];
+		const int shift = digit * 8;
+		if (histogram[(draw_queue[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			uint32_t bucket_count = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucket_count;
+		}
+		for (const DrawItem &item : draw_queue)
+			draw_queue_scratch[histogram[(item.key >> shift) & 0xFF]++] = item;
+		draw_queue.swap(draw_queue_scratch);
+	}
+}
+
+void RenderSystem::flushSprites(const mat3 &projection)
+{
+	if (draw_queue.empty())
+		return;
+	sortDrawQueue();
+
+	// All the instances go into the instance buffer in draw order with a single upload
+	sprite_upload.clear();
+	for (const DrawItem &item : draw_queue)
+		sprite_upload.push_back(queued_instances[item.instance]);
+
+	// queueSprite only takes TEXTURED requests, which are all drawn with its instanced variant
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::SPRITE_BATCH]);
+	const EffectUniforms &uniforms = effect_uniforms[(GLuint)EFFECT_ASSET_ID::SPRITE_BATCH];
+	glUniformMatrix3fv(uniforms.projection, 1, GL_FALSE, (float *)&projection);
+	// Same clock as Animation::start_time
+	glUniform1f(uniforms.time, (float)(timers.game_time_ms() / 1000.0));
+	glActiveTexture(GL_TEXTURE0);
+
+	const GLint first_instance = streamUpload(sprite_upload.data(), sprite_upload.size(), sizeof(SpriteInstance));
+	if (first_instance < 0)
+	{
+		draw_queue.clear();
+		queued_instances.clear();
+		return;
+	}
+
+	const size_t count = draw_queue.size();
+	size_t first = 0;
+	while (first < count)
+	{
+		// Everything above the depth is the state the run needs
+		const uint64_t state = draw_queue[first].key >> SORT_KEY_DEPTH_BITS;
+		size_t last = first + 1;
+		while (last < count && (draw_queue[last].key >> SORT_KEY_DEPTH_BITS) == state)
+			last++;
+
+		const GLuint geometry = (GLuint)(draw_queue[first].key >> SORT_KEY_GEOMETRY_SHIFT) & 0xFF;
+		const int page = (int)(draw_queue[first].key >> SORT_KEY_PAGE_SHIFT) & 0xFFFF;
+		bindVertexArray(sprite_vaos[geometry]);
+		bindTexture(atlas_pages[page]);
+
+		// There is no base instance in OpenGL 3.3, so the instance attributes point at where the run starts
+		size_t base = (first_instance + first) * sizeof(SpriteInstance);
+		for (GLuint c = 0; c < 3; c++)
+			glVertexAttribPointer(2 + c, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, transform) + c * sizeof(vec3)));
+		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, uv_rect)));
+		glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, color)));
+		glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, animation)));
+
+		glDrawElementsInstanced(GL_TRIANGLES, index_counts[geometry], GL_UNSIGNED_SHORT, nullptr, (GLsizei)(last - first));
+		frame_stats.draw_calls++;
+		gl_has_errors();
+
+		first = last;
+	}
+
+	draw_queue.clear();
+	queued_instances.clear();
+}
@@ -5,6 +5,7 @@
 
 #include "common.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "timer_wheel.hpp"
 #include <GLFW/glfw3.h>
 #include <algorithm>
 #include <cmath>
@@ -18,14 +19,11 @@ void RenderSystem::initLight() {
     Light& l = registry.lights.emplace(e);
     l.position = {window_width_px/2, window_height_px/2};
 
-    gl_has_errors();
-    glGenVertexArrays(1, &m_light_VAO);
-    gl_has_errors();
 }
 
 int RenderSystem::getCurrentFrame(Entity& e) {
    Animation& a = registry.animations.get(e);
-   return a.current_frame;
+   return a.frameAt((float)(timers.game_time_ms() / 1000.0));
 }
 
 std::vector<vec2> RenderSystem::getEntityCurrentVertices(Entity& e) {
@@ -312,9 +310,16 @@ void RenderSystem::lightScreen() {
         lightVectorPolygon.push_back(vec3(p[0], p[1], 1.0f));
     }
 
-    glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::LIGHT]);
-    glBindVertexArray(m_light_VAO);
-    bindVBOandIBO(GEOMETRY_BUFFER_ID::VISIBILITY_POLYGON, lightVectorPolygon, indices);
+    // The polygon changes every frame, its vertices and indices both go into the stream buffer
+    GLint baseVertex = streamUpload(lightVectorPolygon.data(), lightVectorPolygon.size(), sizeof(vec3));
+    GLint firstIndex = streamUpload(indices.data(), indices.size(), sizeof(uint16_t));
+    if (baseVertex < 0 || firstIndex < 0) {
+        return;
+    }
+
+    useProgram(effects[(GLuint)EFFECT_ASSET_ID::LIGHT]);
+    const EffectUniforms &uniforms = effect_uniforms[(GLuint)EFFECT_ASSET_ID::LIGHT];
+    bindVertexArray(geometry_vaos[(GLuint)GEOMETRY_BUFFER_ID::VISIBILITY_POLYGON]);
 
     glStencilMask(0xFF);
     glClearStencil(0);
@@ -328,49 +333,26 @@ void RenderSystem::lightScreen() {
     gl_has_errors();
 
     // Draw everything in visibility polygon normally
-	const GLuint light_program = effects[(GLuint)EFFECT_ASSET_ID::LIGHT];
-	GLint in_position_loc = glGetAttribLocation(light_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-
     mat3 projection = createProjectionMatrix();
-	GLuint projection_loc = glGetUniformLocation(light_program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-
-	GLuint shadow_on_loc = glGetUniformLocation(light_program, "shadow_on");
-    glUniform1f(shadow_on_loc, 0.f);
+	glUniformMatrix3fv(uniforms.projection, 1, GL_FALSE, (float *)&projection);
+    glUniform1f(uniforms.shadow_on, 0.f);
 
-    glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_SHORT, nullptr);
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_SHORT,
+            (void*)(firstIndex * sizeof(uint16_t)), baseVertex);
+    frame_stats.draw_calls++;
 
     // Now draw shadow
     glStencilMask(0x00);
     glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
     glStencilMask(0x00);
-    glUniform1f(shadow_on_loc, 1.0f);
-
-    vec2 innerTopLeftCorner = vec2(window_width_px - 1175, window_height_px - 650);
-    vec2 innerTopRightCorner = vec2(window_width_px - 75, window_height_px - 650);
-    vec2 innerBottomLeftCorner = vec2(window_width_px - 1175, window_height_px - 100);
-    vec2 innerBottomRightCorner = vec2(window_width_px - 75, window_height_px - 100);
-
-	std::vector<vec3> shadow_vertices(4);
-    shadow_vertices[0] = { innerTopLeftCorner, 1.0f }; // Top-left
-    shadow_vertices[1] = { innerTopRightCorner, 1.0f }; // Top-right
-    shadow_vertices[2] = {  innerBottomRightCorner, 1.0f }; // Bottom-right
-    shadow_vertices[3] = { innerBottomLeftCorner, 1.0f }; // Bottom-left
-
-	const std::vector<uint16_t> shadow_indices = { 0, 1, 2, 0, 2, 3};
-
-    bindVBOandIBO(GEOMETRY_BUFFER_ID::SHADOW_PLANE, 
-            shadow_vertices,
-            shadow_indices);
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+    glUniform1f(uniforms.shadow_on, 1.0f);
 
+    // The shadow covers the whole room, which never changes, so it was uploaded once at init
+    bindVertexArray(geometry_vaos[(GLuint)GEOMETRY_BUFFER_ID::SHADOW_PLANE]);
 	gl_has_errors();
-    glDrawElements(GL_TRIANGLES, (GLsizei) shadow_indices.size(), GL_UNSIGNED_SHORT, nullptr);
+    glDrawElements(GL_TRIANGLES, index_counts[(GLuint)GEOMETRY_BUFFER_ID::SHADOW_PLANE], GL_UNSIGNED_SHORT, nullptr);
+    frame_stats.draw_calls++;
     glDisable(GL_STENCIL_TEST);
     /* gl_has_errors(); */
 
@@ -11,238 +11,146 @@
 #include "common.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "timer_wheel.hpp"
+#include "floating_text.hpp"
 
 #include "distort.hpp"
 
 extern DistortToggle toggle;
 
-void RenderSystem::renderTextBulk(std::vector<TextRenderRequest>& requests)
+void RenderSystem::layoutText(const char *text, float scale, std::vector<TextVertex> &out)
 {
-    glUseProgram(m_font_shaderProgram);
-    glBindVertexArray(m_font_VAO);
-
-    for (const auto& request : requests)
+    out.clear();
+    float currentX = 0.f;
+    for (const char *c = text; *c != '\0'; c++)
     {
-        GLint textColor_location = glGetUniformLocation(m_font_shaderProgram, "textColor");
-        glUniform3f(textColor_location, request.color.x, request.color.y, request.color.z);
-
-        GLint transformLoc = glGetUniformLocation(m_font_shaderProgram, "transform");
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(request.transform));
-
-        float currentX = request.x;
-        
-        for (const char c : request.text)
-        {
-            Character ch = m_ftCharacters[c];
-
-            float xpos = currentX + ch.Bearing.x * request.scale;
-            float ypos = request.y - (ch.Size.y - ch.Bearing.y) * request.scale;
-
-            float w = ch.Size.x * request.scale;
-            float h = ch.Size.y * request.scale;
+        if ((unsigned char)*c >= FONT_CHARACTER_COUNT)
+            continue;
+        const Character& ch = m_ftCharacters[(unsigned char)*c];
 
-            float vertices[6][4] = {
-                { xpos,     ypos + h,   0.0f, 0.0f },
-                { xpos,     ypos,       0.0f, 1.0f },
-                { xpos + w, ypos,       1.0f, 1.0f },
+        float xpos = currentX + ch.Bearing.x * scale;
+        float ypos = -(ch.Size.y - ch.Bearing.y) * scale;
 
-                { xpos,     ypos + h,   0.0f, 0.0f },
-                { xpos + w, ypos,       1.0f, 1.0f },
-                { xpos + w, ypos + h,   1.0f, 0.0f }
-            };
+        float w = ch.Size.x * scale;
+        float h = ch.Size.y * scale;
+        currentX += (ch.Advance >> 6) * scale;
+        if (ch.Size.x == 0 || ch.Size.y == 0)
+            continue;
 
-            glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+        auto corner = [&](float x, float y, float u, float v) {
+            out.push_back({ vec2(x, y), vec2(ch.uv_rect.x + u * ch.uv_rect.z, ch.uv_rect.y + v * ch.uv_rect.w), vec3(1.f) });
+        };
+        corner(xpos,     ypos + h, 0.f, 0.f);
+        corner(xpos,     ypos,     0.f, 1.f);
+        corner(xpos + w, ypos,     1.f, 1.f);
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        corner(xpos,     ypos + h, 0.f, 0.f);
+        corner(xpos + w, ypos,     1.f, 1.f);
+        corner(xpos + w, ypos + h, 1.f, 0.f);
+    }
+}
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+void RenderSystem::appendText(const std::vector<TextVertex> &layout, vec2 origin, vec3 color)
+{
+    for (const TextVertex &vertex : layout)
+        m_text_vertices.push_back({ vertex.position + origin, vertex.texcoord, color });
+}
 
-            currentX += (ch.Advance >> 6) * request.scale;
+void RenderSystem::renderTextBulk(int window_height)
+{
+    // Every character becomes two triangles in one vertex buffer, so all the text is a single draw
+    m_text_vertices.clear();
+    for (Text &text : registry.texts.components)
+    {
+        // HUD strings rarely change, so their glyphs are kept until they do
+        if (text.layout_scale != text.scale || text.layout_text != text.text)
+        {
+            layoutText(text.text.c_str(), text.scale, text.layout);
+            text.layout_text = text.text;
+            text.layout_scale = text.scale;
         }
+        appendText(text.layout, vec2(text.position.x, window_height - text.position.y), text.color);
     }
-
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    floatingTexts.for_each([&](const FloatingText &floating) {
+        layoutText(floating.text, floating.scale, m_text_scratch);
+        appendText(m_text_scratch, vec2(floating.position.x, window_height - floating.position.y), floating.color);
+    });
+    if (m_text_vertices.empty())
+        return;
+
+    const GLint first = streamUpload(m_text_vertices.data(), m_text_vertices.size(), sizeof(TextVertex));
+    if (first < 0)
+        return;
+
+    useProgram(m_font_shaderProgram);
+    bindVertexArray(m_font_VAO);
+    glActiveTexture(GL_TEXTURE0);
+    bindTexture(m_font_atlas);
+    glDrawArrays(GL_TRIANGLES, first, (GLsizei)m_text_vertices.size());
+    frame_stats.draw_calls++;
+    gl_has_errors();
 }
 
-void RenderSystem::updateAnimations(float elapsed_ms) {
-    float elapsed_seconds = elapsed_ms / 1000.f;
-    
-    for (auto entity : registry.animations.entities) {
-        Animation& anim = registry.animations.get(entity);
+// The frames themselves are picked in sprite_batch.vs.glsl from when the animation started, all that is
+// left here is holding idle players and roaming enemies on their first frame
+void RenderSystem::updateAnimations() {
+    const float now = (float)(timers.game_time_ms() / 1000.0);
 
-        Motion motion;
-        if (registry.enemyMotions.has(entity)) {
-            motion = registry.enemyMotions.get(entity);
-        }
-        else if (registry.wallMotions.has(entity)) {
-            motion = registry.wallMotions.get(entity);
-        }
-        else if (registry.projectileMotions.has(entity)) {
-            motion = registry.projectileMotions.get(entity);
-        }
-        else {
-            motion = registry.motions.get(entity);
-        }
+    for (uint i = 0; i < registry.animations.size(); i++) {
+        Animation& anim = registry.animations.components[i];
         if (!anim.is_playing) continue;
 
-		if (
-			(registry.players.has(entity) && (motion.velocity.x != 0 || motion.velocity.y != 0)) ||
-			(registry.enemies.has(entity) && registry.enemies.get(entity).enemyState != EnemyState::ROAMING)
-		) {
-			anim.current_time += elapsed_seconds;
-			if (anim.current_time >= anim.frame_time) {
-				anim.current_time = 0.f;
-				anim.current_frame++;
-				
-				if (anim.current_frame >= anim.num_frames) {
-					if (anim.loop) {
-						anim.current_frame = 0;
-					} else {
-						anim.current_frame = anim.num_frames - 1;
-						anim.is_playing = false;
-					}
-				}
-			}
-		} else {
-			anim.current_time = 0.f;
-			anim.current_frame = 0;
-		}
+        Entity entity = registry.animations.entities[i];
+        bool animating = false;
+        if (registry.players.has(entity)) {
+            const vec2 &velocity = registry.motions.get(entity).velocity;
+            animating = velocity.x != 0 || velocity.y != 0;
+        } else if (registry.enemies.has(entity)) {
+            animating = registry.enemies.get(entity).enemyState != EnemyState::ROAMING;
+        }
+        if (!animating) {
+            anim.start_time = now;
+        }
     }
 }
 
 
-void RenderSystem::drawTexturedMeshWithAnim(Entity entity, const mat3& projection, const Animation& anim) {
-	assert(registry.renderRequests.has(entity));
-    const RenderRequest& render_request = registry.renderRequests.get(entity);
-    const ivec2& tex_size = texture_dimensions[(GLuint)render_request.used_texture];
-
-    float frame_width = float(anim.sprite_width) / tex_size.x;
-    float frame_x = (anim.current_frame * anim.sprite_width) / float(tex_size.x);
-
-    std::vector<TexturedVertex> textured_vertices(4);
-    textured_vertices[0].position = { -1.f/2, +1.f/2, 0.f };
-    textured_vertices[1].position = { +1.f/2, +1.f/2, 0.f };
-    textured_vertices[2].position = { +1.f/2, -1.f/2, 0.f };
-    textured_vertices[3].position = { -1.f/2, -1.f/2, 0.f };
-    textured_vertices[0].texcoord = { frame_x, 1.f };
-    textured_vertices[1].texcoord = { frame_x + frame_width, 1.f };
-    textured_vertices[2].texcoord = { frame_x + frame_width, 0.f };
-    textured_vertices[3].texcoord = { frame_x, 0.f };
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TexturedVertex) * textured_vertices.size(), textured_vertices.data());
-}
-
-
 void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection)
 {
-    Motion motion;
-    if (registry.enemyMotions.has(entity)) {
-        motion = registry.enemyMotions.get(entity);
-    }
-    else if (registry.wallMotions.has(entity)) {
-        motion = registry.wallMotions.get(entity);
-    }
-    else if (registry.projectileMotions.has(entity)) {
-        motion = registry.projectileMotions.get(entity);
-    }
-    else {
-        motion = registry.motions.get(entity);
-    }
 	Transform transform;
-	transform.translate(motion.position);
+	transform.mat = getEntityTransform(entity);
 	
 	assert(registry.renderRequests.has(entity));
 	const RenderRequest &render_request = registry.renderRequests.get(entity);
 
-    if (fabsf(motion.angle) < (M_PI/2) && !(registry.projectiles.has(entity))) {
-        transform.rotate(motion.angle - M_PI);
-        transform.scale(vec2(-motion.scale.x, motion.scale.y));
-    }
-    else {
-        transform.rotate(motion.angle);
-        transform.scale(motion.scale);
-    }
-
 	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
+	assert(render_request.used_effect == EFFECT_ASSET_ID::TEXTURED && "Type of render request not supported");
+	const EffectUniforms &uniforms = effect_uniforms[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
+	useProgram(effects[used_effect_enum]);
 	gl_has_errors();
 
+	// The VAO holds the vertex layout and the index buffer of the geometry
 	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
+	const GLuint geometry = (GLuint)render_request.used_geometry;
+	bindVertexArray(geometry_vaos[geometry]);
 
-	// Input data location as in the vertex buffer
-	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED)
-	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(TexturedVertex), (void *)0);
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void *)sizeof(
-				vec3)); // note the stride to skip the preceeding vertex position
-
-		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
-		assert(registry.renderRequests.has(entity));
-		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		gl_has_errors();
-	}
-	else
-	{
-		assert(false && "Type of render request not supported");
-	}
+	// Enabling and binding texture to slot 0
+	glActiveTexture(GL_TEXTURE0);
+	GLuint used_texture = (GLuint)render_request.used_texture;
+	bindTexture(atlas_pages[texture_pages[used_texture]]);
+	glUniform4fv(uniforms.uv_rect, 1, (float *)&texture_uv_rects[used_texture]);
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
 	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
+	glUniform3fv(uniforms.fcolor, 1, (float *)&color);
+	glUniformMatrix3fv(uniforms.transform, 1, GL_FALSE, (float *)&transform.mat);
+	glUniformMatrix3fv(uniforms.projection, 1, GL_FALSE, (float *)&projection);
 	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	glDrawElements(GL_TRIANGLES, index_counts[geometry], GL_UNSIGNED_SHORT, nullptr);
+	frame_stats.draw_calls++;
 	gl_has_errors();
 }
 
@@ -252,15 +160,9 @@ void RenderSystem::drawToScreen()
 {
 	// Setting shaders
 	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-
-	GLuint distortion_on = glGetUniformLocation(effects[(GLuint)EFFECT_ASSET_ID::WATER], "distort_on");
-
-    if (toggle == DISTORT_ON) {
-        glUniform1i(distortion_on, 1);  
-    } else {
-        glUniform1i(distortion_on, 0); 
-    }
+	const EffectUniforms &uniforms = effect_uniforms[(GLuint)EFFECT_ASSET_ID::WATER];
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
+	glUniform1i(uniforms.distort_on, toggle == DISTORT_ON ? 1 : 0);
 
 	gl_has_errors();
 	// Clearing backbuffer
@@ -275,59 +177,43 @@ void RenderSystem::drawToScreen()
 	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDisable(GL_DEPTH_TEST);
 
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-																	 // indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
 	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	GLuint light_up_uloc = glGetUniformLocation(water_program, "light_up");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+	glUniform1f(uniforms.time, (float)(glfwGetTime() * 10.0f));
 	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
+	glUniform1f(uniforms.darken_screen_factor, screen.darken_screen_factor);
 	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
 
 	// Set high score flash value
     float light_up_amount = 0.f;
     if (registry.lightUps.has(screen_state_entity)) {
-        LightUp& lightUp = registry.lightUps.get(screen_state_entity);
-        light_up_amount = lightUp.timer / 1.5f;
+        light_up_amount = timers.remaining_ms(screen_state_entity, TimerKind::LIGHT_UP) / 1000.f / 1.5f;
     }
-    glUniform1f(light_up_uloc, light_up_amount);
-
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
-	gl_has_errors();
+    glUniform1f(uniforms.light_up, light_up_amount);
 
-	// Bind our texture in Texture Unit 0
+	// Draw the screen texture on the screen triangle, bound in Texture Unit 0
+	bindVertexArray(geometry_vaos[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
 	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	bindTexture(off_screen_render_buffer_color);
 	gl_has_errors();
 	// Draw
 	glDrawElements(
 		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
 		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
 				  // no offset from the bound index buffer
+	frame_stats.draw_calls++;
 	gl_has_errors();
 }
 
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw(float elapsed_ms, bool isPaused)
+void RenderSystem::draw(bool isPaused)
 {
 	// Getting size of window
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindVertexArray(vao);
+	resetStateCache();
+	stream_buffer.beginFrame();
+	bindVertexArray(vao);
 
 	// First render to the custom framebuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
@@ -352,7 +238,7 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
 	mat3 projection_2D = createCameraMatrix();
 
     if (!isPaused) {
-        updateAnimations(elapsed_ms);
+        updateAnimations();
     }
 
 	// Draw all textured meshes that have a position and size component
@@ -367,29 +253,17 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
 
         drawGameBackground();
         drawSpaceship();
-        drawFloor();
+        drawLevel();
 
-        for (Entity entity : registry.renderRequests.entities)
-        {
-            if (registry.clickables.has(entity) || registry.players.has(entity) || entity == hoverEntity) 
-                continue;
-            // Note, its not very efficient to access elements indirectly via the entity
-            // albeit iterating through all Sprites in sequence. A good point to optimize
-                
-            if (registry.animations.has(entity)) {
-                drawTexturedMeshWithAnim(entity, projection_2D, registry.animations.get(entity));
-            }
-            drawTexturedMesh(entity, projection_2D);
-        }
+        queueVisibleSprites();
+        flushSprites(projection_2D);
         if (LIGHT_SYSTEM_TOGGLE) {
             lightScreen();
         }
         // Draw player AFTER shadow has been cast so it is not shaded
         Entity player = registry.players.entities[0];
-        drawTexturedMeshWithAnim(player, projection_2D, registry.animations.get(player));
-        drawTexturedMesh(player, projection_2D);
-        
-        glBindVertexArray(vao);
+        queueSprite(player);
+        flushSprites(projection_2D);
     }
     else if (ss.activeScreen == (int) SCREEN_ID::DEATH_SCREEN) {
         drawDeathScreen();
@@ -404,7 +278,6 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
     if (ss.activeScreen == (int)SCREEN_ID::GAME_SCREEN)
 	{
 		// Render text
-		glBindVertexArray(0);
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glViewport(0, 0, w, h);
@@ -412,16 +285,7 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
 		int w, h;
 		glfwGetWindowSize(window, &w, &h);
 
-		std::vector<TextRenderRequest> texts = {};
-
-		for (Entity entity: registry.texts.entities) {
-			Text &text = registry.texts.get(entity);
-			texts.emplace_back(text.text, text.position.x, h - text.position.y, text.scale, text.color, glm::mat4(4.0f));
-		}
-		
-		if (!texts.empty()) {
-			renderTextBulk(texts);
-		}
+		renderTextBulk(h);
 		if (mouseGestures.isToggled) {
 			drawMouseGestures();
 		}
@@ -436,6 +300,8 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
         drawPauseMenu();
     }
 
+	stream_buffer.endFrame();
+
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
 	gl_has_errors();
@@ -444,133 +310,58 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
 
 
 void RenderSystem::drawMouseGestures() {
-    glUseProgram(ges_shaderProgram);
+    useProgram(ges_shaderProgram);
     gl_has_errors();
-    glUniform1f(glGetUniformLocation(ges_shaderProgram, "thickness"), 4.0f);
-    glBindVertexArray(ges_VAO);
+    glUniform1f(ges_thickness_loc, 4.0f);
+    bindVertexArray(ges_VAO);
     auto &path = mouseGestures.renderPath;
     
     if (mouseGestures.isHeld && !mouseGestures.gesturePath.empty()) {
-        std::vector<vec2> expandedPath;
-        std::vector<float> sides;
-        
+        gesture_vertices.clear();
         for (const auto& point : path) {
-            expandedPath.push_back(point);
-            expandedPath.push_back(point);
-            sides.push_back(-1.0f);
-            sides.push_back(1.0f);
+            gesture_vertices.push_back({point, -1.0f});
+            gesture_vertices.push_back({point, 1.0f});
         }
 
-        glBindBuffer(GL_ARRAY_BUFFER, ges_VBO);
-        glBufferData(GL_ARRAY_BUFFER, expandedPath.size() * sizeof(vec2), expandedPath.data(), GL_DYNAMIC_DRAW);
-        gl_has_errors();
-
-        GLuint sideVBO;
-        glGenBuffers(1, &sideVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, sideVBO);
-        glBufferData(GL_ARRAY_BUFFER, sides.size() * sizeof(float), sides.data(), GL_DYNAMIC_DRAW);
-        gl_has_errors();
-
-        glBindBuffer(GL_ARRAY_BUFFER, ges_VBO);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        glBindBuffer(GL_ARRAY_BUFFER, sideVBO);
-        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, expandedPath.size());
-        glDeleteBuffers(1, &sideVBO);
+        GLint first = streamUpload(gesture_vertices.data(), gesture_vertices.size(), sizeof(GestureVertex));
+        if (first >= 0) {
+            glDrawArrays(GL_TRIANGLE_STRIP, first, (GLsizei)gesture_vertices.size());
+            frame_stats.draw_calls++;
+        }
     }
-
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
     gl_has_errors();
 }
 
-void RenderSystem::drawMainMenu() {
-
-    // Draw buttons first since drawing front to back
-    // Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-																	 // indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
+// Fills the screen with one of the menu images through the water effect
+void RenderSystem::drawScreenImage(GLuint texture)
+{
+	const EffectUniforms &uniforms = effect_uniforms[(GLuint)EFFECT_ASSET_ID::WATER];
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
 	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
+	glUniform1f(uniforms.time, (float)(glfwGetTime() * 10.0f));
+	ScreenState& screen = registry.screenStates.get(screen_state_entity);
+	glUniform1f(uniforms.darken_screen_factor, screen.darken_screen_factor);
 	gl_has_errors();
 
+	bindVertexArray(geometry_vaos[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
 	// Bind our texture in Texture Unit 0
 	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, mainMenuTexture);
+	bindTexture(texture);
 	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-				  // no offset from the bound index buffer
-    drawButtons();
+	// one triangle = 3 vertices
+	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, nullptr);
+	frame_stats.draw_calls++;
 	gl_has_errors();
-
 }
 
-void RenderSystem::drawTutorial() {
-
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, tutorialTexture);
+void RenderSystem::drawMainMenu() {
+    drawScreenImage(mainMenuTexture);
+    drawButtons();
 	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
+}
 
+void RenderSystem::drawTutorial() {
+	drawScreenImage(tutorialTexture);
 	gl_has_errors();
 }
 
@@ -626,21 +417,30 @@ mat3 RenderSystem::createProjectionMatrix()
 	return {{sx, 0.f, 0.f}, {0.f, sy, 0.f}, {tx, ty, 1.f}};
 }
 
-mat3 RenderSystem::createCameraMatrix()
+void RenderSystem::getViewRect(vec2 &top_left, vec2 &bottom_right)
 {
-	// Fake projection matrix, scales with respect to window coordinates
-
+    // The camera follows the player
     int w, h;
     glfwGetFramebufferSize(window, &w, &h);
     Entity p = registry.players.entities[0];
     Motion& m = registry.motions.get(p);
 
-	float left = m.position.x - w/2;
-	float top = m.position.y - h/2;
+    top_left = vec2(m.position.x - w/2, m.position.y - h/2);
+    bottom_right = vec2(m.position.x + w/2, m.position.y + h/2);
+}
+
+mat3 RenderSystem::createCameraMatrix()
+{
+	// Fake projection matrix, scales with respect to window coordinates
+    vec2 top_left, bottom_right;
+    getViewRect(top_left, bottom_right);
+
+	float left = top_left.x;
+	float top = top_left.y;
 
 	gl_has_errors();
-	float right = m.position.x + w/2;
-	float bottom = m.position.y + h/2;
+	float right = bottom_right.x;
+	float bottom = bottom_right.y;
 
 	float sx = 2.f / (right - left);
 	float sy = 2.f / (top - bottom);
@@ -660,339 +460,87 @@ int RenderSystem::getActiveScreen() const {
 }
 
 void RenderSystem::drawPauseMenu() {
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, pauseMenuTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
+	drawScreenImage(pauseMenuTexture);
     drawButtons();
-
 	gl_has_errors();
-
 }
 
 void RenderSystem::drawDeathScreen() {
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, deathScreenTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
+	drawScreenImage(deathScreenTexture);
     drawButtons();
-
 	gl_has_errors();
-
 }
 
 void RenderSystem::drawWinScreen() {
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, winScreenTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
+	drawScreenImage(winScreenTexture);
     drawButtons();
-
 	gl_has_errors();
-
 }
 
-void RenderSystem::drawGameBackground() {
-    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
-	glUseProgram(program);
+// Draws a whole texture that is not in the atlas on one of the quad geometries, in world space
+void RenderSystem::drawBackdrop(GEOMETRY_BUFFER_ID geometry, GLuint texture, const Transform &transform) {
+    const EffectUniforms &uniforms = effect_uniforms[(GLuint)EFFECT_ASSET_ID::TEXTURED];
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::TEXTURED]);
+	bindVertexArray(geometry_vaos[(GLuint)geometry]);
 	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-    GLint in_position_loc = glGetAttribLocation(program, "in_position");
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    gl_has_errors();
-    assert(in_texcoord_loc >= 0);
-
-    glEnableVertexAttribArray(in_position_loc);
-    glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(TexturedVertex), (void *)0);
-    gl_has_errors();
-
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-        in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-        (void *)sizeof(
-            vec3)); // note the stride to skip the preceeding vertex position
 
     // Enabling and binding texture to slot 0
     glActiveTexture(GL_TEXTURE0);
+    bindTexture(texture);
     gl_has_errors();
 
-    glBindTexture(GL_TEXTURE_2D, gameBackgroundTexture);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+    mat3 projection = createCameraMatrix();
+	const vec3 color = vec3(1);
+	glUniform3fv(uniforms.fcolor, 1, (float *)&color);
+	// Not in the atlas, the whole texture is used
+	glUniform4f(uniforms.uv_rect, 0.f, 0.f, 1.f, 1.f);
+	glUniformMatrix3fv(uniforms.transform, 1, GL_FALSE, (float *)&transform.mat);
+	glUniformMatrix3fv(uniforms.projection, 1, GL_FALSE, (float *)&projection);
 	gl_has_errors();
+	// Drawing of num_indices/3 triangles specified in the index buffer
+	glDrawElements(GL_TRIANGLES, index_counts[(GLuint)geometry], GL_UNSIGNED_SHORT, nullptr);
+	frame_stats.draw_calls++;
+	gl_has_errors();
+}
 
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
+void RenderSystem::drawGameBackground() {
     Transform transform;
     int w, h;
     glfwGetWindowSize(window, &w, &h);
     transform.translate(vec2(w,h));
     transform.scale(vec2(6000,-3000));
-    mat3 projection = createCameraMatrix();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-
+    drawBackdrop(GEOMETRY_BUFFER_ID::UI_COMPONENT, gameBackgroundTexture, transform);
 }
 
-void RenderSystem::drawFloor() {
-    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
-	glUseProgram(program);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::FLOOR]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::FLOOR]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-    GLint in_position_loc = glGetAttribLocation(program, "in_position");
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    gl_has_errors();
-    assert(in_texcoord_loc >= 0);
+void RenderSystem::drawLevel() {
+    if (level_index_count == 0)
+        return;
 
-    glEnableVertexAttribArray(in_position_loc);
-    glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(TexturedVertex), (void *)0);
-    gl_has_errors();
-
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-        in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-        (void *)sizeof(
-            vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
+    useProgram(effects[(GLuint)EFFECT_ASSET_ID::LEVEL]);
+    bindVertexArray(level_VAO);
+    // One draw call needs the walls and the floor on the same atlas page
+    assert(texture_pages[(GLuint)TEXTURE_ASSET_ID::WALL] == texture_pages[(GLuint)TEXTURE_ASSET_ID::FLOOR]);
     glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
+    bindTexture(atlas_pages[texture_pages[(GLuint)TEXTURE_ASSET_ID::WALL]]);
 
-    glBindTexture(GL_TEXTURE_2D, floorTexture);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-    Transform transform;
-    /* transform.translate(vec2(500,300)); */
-    /* transform.scale(vec2(200,-200)); */
     mat3 projection = createCameraMatrix();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-
-}
-
-void RenderSystem::drawSpaceship() {
-    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
-	glUseProgram(program);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-    GLint in_position_loc = glGetAttribLocation(program, "in_position");
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
+    glUniformMatrix3fv(effect_uniforms[(GLuint)EFFECT_ASSET_ID::LEVEL].projection, 1, GL_FALSE, (float *)&projection);
     gl_has_errors();
-    assert(in_texcoord_loc >= 0);
-
-    glEnableVertexAttribArray(in_position_loc);
-    glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(TexturedVertex), (void *)0);
-    gl_has_errors();
-
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-        in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-        (void *)sizeof(
-            vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
-
-    glBindTexture(GL_TEXTURE_2D, spaceshipTexture);
+    glDrawElements(GL_TRIANGLES, level_index_count, GL_UNSIGNED_INT, nullptr);
+    frame_stats.draw_calls++;
     gl_has_errors();
+}
 
-    // Getting uniform locations for glUniform* calls
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
+void RenderSystem::drawSpaceship() {
     int w, h;
     glfwGetWindowSize(window, &w, &h);
     Transform transform;
 
     transform.translate(vec2(w,h));
     transform.scale(vec2(w*3.0f,-h*3.0f));
-    mat3 projection = createCameraMatrix();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-
+    drawBackdrop(GEOMETRY_BUFFER_ID::UI_COMPONENT, spaceshipTexture, transform);
 }
+
 void RenderSystem::flipActiveButtions(int activeScreen) {
     for (Entity e : registry.clickables.entities) {
         Clickable& c = registry.clickables.get(e);
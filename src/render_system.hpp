@@ -1,15 +1,16 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <utility>
 
 #include "common.hpp"
 #include "components.hpp"
+#include "stream_buffer.hpp"
 #include "tiny_ecs.hpp"
 
 #include "../ext/freetype/include/ft2build.h"
 #include FT_FREETYPE_H
-#include <map>
 
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
@@ -22,8 +23,16 @@ class RenderSystem
      * Whenever possible, add to these lists instead of creating dynamic state
      * it is easier to debug and faster to execute for the computer.
      */
-    std::array<GLuint, texture_count> texture_gl_handles;
+    // The textures are packed into a few atlas pages at load time so sprites with different textures
+    // can share a draw call, see initializeGlTextures
+    std::vector<GLuint> atlas_pages;
+    std::array<int, texture_count> texture_pages;
+    // Offset and size of each texture inside its page in uv coordinates
+    std::array<vec4, texture_count> texture_uv_rects;
     std::array<ivec2, texture_count> texture_dimensions;
+    static const int ATLAS_PAGE_SIZE = 1024;
+    // Every texture has its border pixels repeated this far around it, so sampling never picks up a neighbour
+    static const int ATLAS_PADDING = 2;
 
     // Make sure these paths remain in sync with the associated enumerators.
     // Associated id with .obj path
@@ -56,22 +65,61 @@ class RenderSystem
         textures_path("health-bar.png"),
         textures_path("player-health-bar.png"),
         sprite_sheets_path("boss-enemy-sprite-sheet.png"),
-        sprite_sheets_path("necromancer-enemy-sprite-sheet.png")
+        sprite_sheets_path("necromancer-enemy-sprite-sheet.png"),
+        textures_path("floor-tile.png")
     };
 
     std::array<GLuint, effect_count> effects;
+    // Uniform locations of every effect, looked up once when the programs are linked.
+    // -1 when the effect has no such uniform, which glUniform* quietly ignores.
+    struct EffectUniforms
+    {
+        GLint transform;
+        GLint projection;
+        GLint fcolor;
+        GLint uv_rect;
+        GLint time;
+        GLint darken_screen_factor;
+        GLint light_up;
+        GLint distort_on;
+        GLint shadow_on;
+    };
+    std::array<EffectUniforms, effect_count> effect_uniforms;
     // Make sure these paths remain in sync with the associated enumerators.
     const std::array<std::string, effect_count> effect_paths = {
         shader_path("textured"),
         shader_path("water"),
         shader_path("light"),
+        shader_path("sprite_batch"),
+        shader_path("level"),
     };
 
     std::array<GLuint, geometry_count> vertex_buffers;
     std::array<GLuint, geometry_count> index_buffers;
     std::array<Mesh, geometry_count> meshes;
+    // Number of indices in each index buffer, so draws don't have to ask the driver
+    std::array<GLsizei, geometry_count> index_counts = {};
+    // One VAO per geometry with its vertex layout and index buffer already set up,
+    // so drawing a geometry is binding its VAO
+    std::array<GLuint, geometry_count> geometry_vaos;
 
 public:
+    // What drawing the last frame took, to check how much batching and sorting are saving
+    struct RenderStats
+    {
+        int draw_calls = 0;
+        int program_binds = 0;
+        int texture_binds = 0;
+        // Vertex array and vertex buffer binds
+        int buffer_binds = 0;
+        // Sprites that were inside the view and sprites that were culled
+        int sprites_drawn = 0;
+        int sprites_culled = 0;
+        // Uploads that did not fit in the stream buffer, what they were for is not drawn
+        int dropped_uploads = 0;
+    };
+    const RenderStats &getFrameStats() const { return frame_stats; }
+
     // Initialize the window
     bool init(GLFWwindow *window);
 
@@ -88,6 +136,8 @@ public:
     Mesh &getMesh(GEOMETRY_BUFFER_ID id) { return meshes[(int)id]; };
 
     void initializeGlGeometryBuffers();
+    void initializeGeometryVAOs();
+    static bool isTexturedGeometry(GEOMETRY_BUFFER_ID geometry);
     // Initialize the screen texture used as intermediate render target
     // The draw loop first renders to this texture, then it is used for the wind
     // shader
@@ -111,11 +161,14 @@ public:
     bool initGameBackground();
     void drawGameBackground();
 
-    bool initFloor();
-    void drawFloor();
-    
+    // Walls and floor never change once a map is made, so they are baked into one mesh that is drawn
+    // with a single call. Has to be called again whenever the walls or the grid map are replaced.
+    void bakeLevelGeometry();
+    void drawLevel();
+
     bool initSpaceship();
     void drawSpaceship();
+    void drawBackdrop(GEOMETRY_BUFFER_ID geometry, GLuint texture, const Transform &transform);
 
     bool mouseGestureInit();
 
@@ -151,24 +204,87 @@ public:
     ~RenderSystem();
 
     // Draw all entities
-    void draw(float elapsed_ms, bool isPaused);
+    void draw(bool isPaused);
 
     void drawMouseGestures();
 
     mat3 createProjectionMatrix();
     mat3 createCameraMatrix();
+    // World space rectangle the camera shows
+    void getViewRect(vec2 &top_left, vec2 &bottom_right);
 
     GLFWwindow* getWindow() {return window;};
 
 private:
-    void updateAnimations(float elapsed_ms);
-    void drawTexturedMeshWithAnim(Entity entity, const mat3& projection, const Animation& anim);
+    void updateAnimations();
 
     // Internal drawing functions for each entity type
     void drawTexturedMesh(Entity entity, const mat3 &projection);
     void drawToScreen();
+    void drawScreenImage(GLuint texture);
+
+    // Lays out the glyph quads of text around a baseline origin at (0, 0)
+    void layoutText(const char *text, float scale, std::vector<TextVertex> &out);
+    // Adds already laid out glyph quads to the text batch, moved to origin and tinted with color
+    void appendText(const std::vector<TextVertex> &layout, vec2 origin, vec3 color);
+    // Draws the Text components and the floating texts in one draw call
+    void renderTextBulk(int window_height);
+
+    // Sorted and batched sprite drawing, see render_batch.cpp
+    void initSpriteBatching();
+    const Motion &getEntityMotion(Entity entity);
+    mat3 getEntityTransform(Entity entity);
+    void queueSprite(Entity entity);
+    // Queues the sprites of the game world that are inside the camera's view
+    void queueVisibleSprites();
+    // Draws everything queued since the last flush in sort key order, one instanced draw per run of
+    // sprites that share a layer, effect, atlas page and geometry
+    void flushSprites(const mat3 &projection);
+    void sortDrawQueue();
+
+    // Coarse draw order of the sprites in a flush, each layer is drawn over the ones before it
+    enum class RENDER_LAYER
+    {
+        PICKUPS = 0,
+        ACTORS = PICKUPS + 1,
+        PROJECTILES = ACTORS + 1,
+        OVERLAY = PROJECTILES + 1
+    };
+    RENDER_LAYER getRenderLayer(Entity entity);
 
-    void renderTextBulk(std::vector<TextRenderRequest>& requests);
+    struct DrawItem
+    {
+        uint64_t key;
+        // Index into queued_instances
+        uint32_t instance;
+    };
+    std::vector<DrawItem> draw_queue;
+    std::vector<DrawItem> draw_queue_scratch;
+    std::vector<SpriteInstance> queued_instances;
+    std::vector<SpriteInstance> sprite_upload;
+    // Geometry layout plus the per instance attributes, only made for the textured geometries
+    std::array<GLuint, geometry_count> sprite_vaos;
+
+    // Binds go through these while drawing so a state that is already bound is not bound again.
+    // Anything bound directly with GL in between makes the cache wrong, it is reset every frame.
+    void resetStateCache();
+    void useProgram(GLuint program);
+    void bindTexture(GLuint texture);
+    void bindVertexArray(GLuint vertex_array);
+    void bindArrayBuffer(GLuint buffer);
+    static const GLuint UNKNOWN_BINDING = ~0u;
+    GLuint bound_program = UNKNOWN_BINDING;
+    GLuint bound_texture = UNKNOWN_BINDING;
+    GLuint bound_vertex_array = UNKNOWN_BINDING;
+    GLuint bound_array_buffer = UNKNOWN_BINDING;
+    RenderStats frame_stats;
+
+    // Everything rebuilt every frame is uploaded into this, see stream_buffer.hpp
+    static const GLsizeiptr STREAM_BUFFER_FRAME_BYTES = 4 * 1024 * 1024;
+    StreamBuffer stream_buffer;
+    // Uploads count elements of stride bytes and returns the index of the first one in the stream
+    // buffer, or -1 when it is full. Leaves the stream buffer bound to GL_ARRAY_BUFFER.
+    GLint streamUpload(const void *data, size_t count, size_t stride);
 
     // Window handle
     GLFWwindow *window;
@@ -199,9 +315,6 @@ private:
     GLuint gameBackgroundTexture;
     const std::string gameBackgroundImgPath = textures_path("spaceship-background.png");
 
-    GLuint floorTexture;
-    const std::string floorImgPath = textures_path("floor-tile.png");
-
     GLuint spaceshipTexture;
     const std::string spaceshipImgPath = textures_path("spaceship.png");
 
@@ -212,13 +325,24 @@ private:
 
     GLuint vao;
 
-    GLuint m_light_VAO;
-    GLuint m_light_VBO;
-
-    std::map<char, Character> m_ftCharacters;
+    // The baked level mesh, its indices are 32 bit as a big map has more than 65536 vertices
+    GLuint level_VAO;
+    GLuint level_VBO;
+    GLuint level_IBO;
+    GLsizei level_index_count = 0;
+    std::vector<LevelVertex> level_vertices;
+    std::vector<uint32_t> level_indices;
+
+    // Metrics of the first 128 ASCII characters, indexed by character. Their bitmaps are all in m_font_atlas.
+    static const int FONT_CHARACTER_COUNT = 128;
+    std::array<Character, FONT_CHARACTER_COUNT> m_ftCharacters;
+	GLuint m_font_atlas;
+	static const int FONT_ATLAS_WIDTH = 512;
 	GLuint m_font_shaderProgram;
 	GLuint m_font_VAO;
-	GLuint m_font_VBO;
+	std::vector<TextVertex> m_text_vertices;
+	// Reused for the floating texts, which are too short lived to keep a layout around
+	std::vector<TextVertex> m_text_scratch;
 
     const std::vector<vec2> playerFrame1 = {
         vec2(0.500, 0.035),
@@ -465,14 +589,12 @@ private:
     
     GLuint ges_shaderProgram;
     GLuint ges_VAO;
-    GLuint ges_VBO;
+    std::vector<GestureVertex> gesture_vertices;
+    GLint ges_thickness_loc;
 
     bool distortColor = false;
     bool LIGHT_SYSTEM_TOGGLE = false;
 
-    vec2 m_roomTileDimensions = {50, 30};
-    vec2 m_roomTileSize = {50, 50};
-
 };
 
 bool loadEffectFromFile(
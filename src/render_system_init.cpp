@@ -4,7 +4,10 @@
 #include "render_system.hpp"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstring>
 #include <fstream>
 
 #include "../ext/stb_image/stb_image.h"
@@ -73,6 +76,9 @@ bool RenderSystem::init(GLFWwindow* window_arg)
     initializeGlTextures();
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
+	stream_buffer.init(STREAM_BUFFER_FRAME_BYTES);
+	initializeGeometryVAOs();
+	initSpriteBatching();
 	mouseGestureInit();
 
     saveFileExists = doesSaveFileExist();
@@ -82,7 +88,6 @@ bool RenderSystem::init(GLFWwindow* window_arg)
     initDeathScreen();
     initWinScreen();
     initGameBackground();
-    initFloor();
     initSpaceship();
 
     if (LIGHT_SYSTEM_TOGGLE) {
@@ -118,7 +123,6 @@ bool RenderSystem::mouseGestureInit() {
 	const char* fragmentShaderSource_c = fragmentShaderSource.c_str();
 
 	glGenVertexArrays(1, &ges_VAO);
-	glGenBuffers(1, &ges_VBO);
 
 	unsigned int gest_vertexShader;
 	gest_vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -144,15 +148,18 @@ bool RenderSystem::mouseGestureInit() {
 	assert(project_location > -1);
 	std::cout << "project_location: " << project_location << std::endl;
 	glUniformMatrix4fv(project_location, 1, GL_FALSE, glm::value_ptr(projection));
+	ges_thickness_loc = glGetUniformLocation(ges_shaderProgram, "thickness");
 
 	glDeleteShader(gest_vertexShader);
 	glDeleteShader(ges_fragmentShader);
 
+	// The trail is streamed in every frame, drawMouseGestures picks the first vertex
 	glBindVertexArray(ges_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, ges_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * 1024, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, stream_buffer.buffer());
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GestureVertex), (void *)offsetof(GestureVertex, position));
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(GestureVertex), (void *)offsetof(GestureVertex, side));
 
 	// release buffers
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -174,7 +181,6 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 
 	// font buffer setup
 	glGenVertexArrays(1, &m_font_VAO);
-	glGenBuffers(1, &m_font_VBO);
 
 	// font vertex shader
 	unsigned int font_vertexShader;
@@ -230,8 +236,19 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
 	// load each of the chars - note only first 128 ASCII chars
-	for (unsigned char c = (unsigned char)0; c < (unsigned char)128; c++)
+	// All the glyphs are packed into rows of one atlas texture, the bitmaps are kept until its size is known
+	std::vector<std::vector<unsigned char>> bitmaps(FONT_CHARACTER_COUNT);
+	std::array<ivec2, FONT_CHARACTER_COUNT> corners;
+	// One empty pixel around every glyph so filtering never picks up its neighbour
+	const int GLYPH_PADDING = 1;
+	ivec2 cursor = ivec2(GLYPH_PADDING);
+	int row_height = 0;
+	for (int c = 0; c < FONT_CHARACTER_COUNT; c++)
 	{
+		Character &character = m_ftCharacters[c];
+		character = Character();
+		corners[c] = ivec2(0);
+
 		// load character glyph 
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
 		{
@@ -239,43 +256,63 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 			continue;
 		}
 
-		// generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		const FT_Bitmap &bitmap = face->glyph->bitmap;
+		character.Size = glm::ivec2(bitmap.width, bitmap.rows);
+		character.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+		character.Advance = static_cast<unsigned int>(face->glyph->advance.x);
 
-		// std::cout << "texture: " << c << " = " << texture << std::endl;
+		// FreeType rows can be padded, copy them out tightly
+		bitmaps[c].resize(bitmap.width * bitmap.rows);
+		for (unsigned int row = 0; row < bitmap.rows; row++)
+			memcpy(bitmaps[c].data() + row * bitmap.width, bitmap.buffer + row * bitmap.pitch, bitmap.width);
 
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width, face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
+		if (cursor.x + (int)bitmap.width + GLYPH_PADDING > FONT_ATLAS_WIDTH)
+		{
+			cursor = ivec2(GLYPH_PADDING, cursor.y + row_height + GLYPH_PADDING);
+			row_height = 0;
+		}
+		corners[c] = cursor;
+		cursor.x += bitmap.width + GLYPH_PADDING;
+		row_height = std::max(row_height, (int)bitmap.rows);
+	}
 
-		// set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// now store character for later use
-		Character character = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-			static_cast<unsigned int>(face->glyph->advance.x),
-			(char)c
-		};
-		m_ftCharacters.insert(std::pair<char, Character>(c, character));
+	int atlas_height = 1;
+	while (atlas_height < cursor.y + row_height + GLYPH_PADDING)
+		atlas_height *= 2;
+	std::vector<unsigned char> atlas(FONT_ATLAS_WIDTH * atlas_height, 0);
+	for (int c = 0; c < FONT_CHARACTER_COUNT; c++)
+	{
+		Character &character = m_ftCharacters[c];
+		for (int row = 0; row < character.Size.y; row++)
+			memcpy(atlas.data() + (corners[c].y + row) * FONT_ATLAS_WIDTH + corners[c].x, bitmaps[c].data() + row * character.Size.x, character.Size.x);
+		character.uv_rect = vec4(corners[c].x / (float)FONT_ATLAS_WIDTH, corners[c].y / (float)atlas_height,
+								 character.Size.x / (float)FONT_ATLAS_WIDTH, character.Size.y / (float)atlas_height);
 	}
+
+	glGenTextures(1, &m_font_atlas);
+	glBindTexture(GL_TEXTURE_2D, m_font_atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, FONT_ATLAS_WIDTH, atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+
+	// set texture options
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	// clean up
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
 
-	// bind buffers
+	// bind buffers, the glyph quads are streamed in every frame
 	glBindVertexArray(m_font_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, stream_buffer.buffer());
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)offsetof(TextVertex, position));
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)offsetof(TextVertex, texcoord));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)offsetof(TextVertex, color));
 
 	// release buffers
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -286,30 +323,91 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 
 void RenderSystem::initializeGlTextures()
 {
-    glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
-
+	std::array<stbi_uc*, texture_count> images;
     for(uint i = 0; i < texture_paths.size(); i++)
     {
 		const std::string& path = texture_paths[i];
 		ivec2& dimensions = texture_dimensions[i];
 
-		stbi_uc* data;
         stbi_set_flip_vertically_on_load(true);
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+		images[i] = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
 
-		if (data == NULL)
+		if (images[i] == NULL)
 		{
 			const std::string message = "Could not load the file " + path + ".";
 			fprintf(stderr, "%s", message.c_str());
 			assert(false);
 		}
-		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+
+	// Shelf packing, tallest first so each shelf wastes little height
+	std::array<int, texture_count> order;
+	for (int i = 0; i < texture_count; i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return texture_dimensions[a].y > texture_dimensions[b].y; });
+
+	std::array<ivec2, texture_count> corners;
+	int page = 0;
+	ivec2 cursor = {0, 0};
+	int shelf_height = 0;
+	for (int i : order)
+	{
+		ivec2 padded = texture_dimensions[i] + 2 * ATLAS_PADDING;
+		assert(padded.x <= ATLAS_PAGE_SIZE && padded.y <= ATLAS_PAGE_SIZE && "Texture too big for the atlas");
+		if (cursor.x + padded.x > ATLAS_PAGE_SIZE)
+		{
+			cursor = {0, cursor.y + shelf_height};
+			shelf_height = 0;
+		}
+		if (cursor.y + padded.y > ATLAS_PAGE_SIZE)
+		{
+			page++;
+			cursor = {0, 0};
+			shelf_height = 0;
+		}
+		texture_pages[i] = page;
+		corners[i] = cursor + ATLAS_PADDING;
+		cursor.x += padded.x;
+		shelf_height = std::max(shelf_height, padded.y);
+	}
+
+	atlas_pages.resize(page + 1);
+	glGenTextures((GLsizei)atlas_pages.size(), atlas_pages.data());
+	std::vector<stbi_uc> pixels(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4);
+	for (int p = 0; p < (int)atlas_pages.size(); p++)
+	{
+		std::fill(pixels.begin(), pixels.end(), 0);
+		for (int i = 0; i < texture_count; i++)
+		{
+			if (texture_pages[i] != p)
+				continue;
+			const ivec2& dimensions = texture_dimensions[i];
+			// Copies the padding too, clamping to the nearest edge pixel of the texture
+			for (int y = -ATLAS_PADDING; y < dimensions.y + ATLAS_PADDING; y++)
+			{
+				int src_y = std::clamp(y, 0, dimensions.y - 1);
+				for (int x = -ATLAS_PADDING; x < dimensions.x + ATLAS_PADDING; x++)
+				{
+					int src_x = std::clamp(x, 0, dimensions.x - 1);
+					const stbi_uc* src = images[i] + (src_y * dimensions.x + src_x) * 4;
+					stbi_uc* dst = pixels.data() + ((corners[i].y + y) * ATLAS_PAGE_SIZE + corners[i].x + x) * 4;
+					std::copy(src, src + 4, dst);
+				}
+			}
+			texture_uv_rects[i] = vec4(vec2(corners[i]) / (float)ATLAS_PAGE_SIZE, vec2(dimensions) / (float)ATLAS_PAGE_SIZE);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, atlas_pages[p]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		gl_has_errors();
-		stbi_image_free(data);
-    }
+	}
+
+	for (stbi_uc* image : images)
+		stbi_image_free(image);
 	gl_has_errors();
 }
 
@@ -322,6 +420,20 @@ void RenderSystem::initializeGlEffects()
 
 		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
 		assert(is_valid && (GLuint)effects[i] != 0);
+
+		// Every uniform the draws use, so they never have to ask the driver for one
+		const GLuint program = effects[i];
+		EffectUniforms &uniforms = effect_uniforms[i];
+		uniforms.transform = glGetUniformLocation(program, "transform");
+		uniforms.projection = glGetUniformLocation(program, "projection");
+		uniforms.fcolor = glGetUniformLocation(program, "fcolor");
+		uniforms.uv_rect = glGetUniformLocation(program, "uv_rect");
+		uniforms.time = glGetUniformLocation(program, "time");
+		uniforms.darken_screen_factor = glGetUniformLocation(program, "darken_screen_factor");
+		uniforms.light_up = glGetUniformLocation(program, "light_up");
+		uniforms.distort_on = glGetUniformLocation(program, "distort_on");
+		uniforms.shadow_on = glGetUniformLocation(program, "shadow_on");
+		gl_has_errors();
 	}
 }
 
@@ -329,7 +441,10 @@ void RenderSystem::initializeGlEffects()
 template <class T>
 void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices)
 {
+	// Also called outside of drawing, so the bind itself can't be skipped but the cache is kept right
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)gid]);
+	bound_array_buffer = vertex_buffers[(uint)gid];
+	frame_stats.buffer_binds++;
 	glBufferData(GL_ARRAY_BUFFER,
 		sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
 	gl_has_errors();
@@ -338,6 +453,7 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
     gl_has_errors();
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	index_counts[(uint)gid] = (GLsizei)indices.size();
 	gl_has_errors();
 }
 
@@ -405,37 +521,6 @@ void RenderSystem::initializeGlGeometryBuffers()
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::UI_COMPONENT, ui_vertices, ui_indices);
 
 
-	//////////////////////////
-	// Initialize ui component
-	// The position corresponds to the center of the texture.
-    // Defined in world space
-    const int lowerLeftX = 0;
-    const int lowerLeftY = 0;
-    const int FLOOR_TEXTURE_SIZE = 64;
-
-    float roomWidth = m_roomTileSize.x * m_roomTileDimensions.x;
-    float roomHeight = m_roomTileSize.x * m_roomTileDimensions.y;
-
-	std::vector<TexturedVertex> floor_vertices(4);
-    // bot left
-	floor_vertices[0].position = { lowerLeftX, lowerLeftY, 0.f };
-    // bot right
-	floor_vertices[1].position = { roomWidth, lowerLeftY, 0.f };
-    // top left
-	floor_vertices[2].position = { lowerLeftX, roomHeight, 0.f };
-    // top right
-	floor_vertices[3].position = { roomWidth, roomHeight, 0.f };
-
-	floor_vertices[0].texcoord = { 0.f, 0.f };
-	floor_vertices[1].texcoord = { roomWidth/FLOOR_TEXTURE_SIZE, 0.f };
-	floor_vertices[2].texcoord = { 0.f, roomHeight/FLOOR_TEXTURE_SIZE };
-	floor_vertices[3].texcoord = { roomWidth/FLOOR_TEXTURE_SIZE, roomHeight/FLOOR_TEXTURE_SIZE };
-
-
-	// Counterclockwise as it's the default opengl front winding direction.
-	/* const std::vector<uint16_t> ui_indices = { 0, 3, 1, 1, 3, 2 }; */
-	const std::vector<uint16_t> floor_indices = { 0, 1, 2, 1, 3, 2 };
-	bindVBOandIBO(GEOMETRY_BUFFER_ID::FLOOR, floor_vertices, floor_indices);
 	///////////////////////////////////////////////////////
 	// Initialize screen triangle (yes, triangle, not quad; its more efficient).
 	std::vector<vec3> screen_vertices(3);
@@ -463,13 +548,131 @@ void RenderSystem::initializeGlGeometryBuffers()
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::SHADOW_PLANE,shadow_vertices,shadow_indices);
 }
 
+// The other geometries are plain vec3 positions
+bool RenderSystem::isTexturedGeometry(GEOMETRY_BUFFER_ID geometry)
+{
+	return geometry != GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE &&
+		   geometry != GEOMETRY_BUFFER_ID::VISIBILITY_POLYGON &&
+		   geometry != GEOMETRY_BUFFER_ID::SHADOW_PLANE;
+}
+
+void RenderSystem::initializeGeometryVAOs()
+{
+	glGenVertexArrays((GLsizei)geometry_vaos.size(), geometry_vaos.data());
+	for (uint i = 0; i < geometry_count; i++)
+	{
+		glBindVertexArray(geometry_vaos[i]);
+		// The visibility polygon is rebuilt every frame, so it is drawn straight from the stream buffer
+		bool streamed = i == (uint)GEOMETRY_BUFFER_ID::VISIBILITY_POLYGON;
+		glBindBuffer(GL_ARRAY_BUFFER, streamed ? stream_buffer.buffer() : vertex_buffers[i]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, streamed ? stream_buffer.buffer() : index_buffers[i]);
+
+		// Attribute locations are fixed for every effect in loadEffectFromFile
+		glEnableVertexAttribArray(0);
+		if (isTexturedGeometry((GEOMETRY_BUFFER_ID)i))
+		{
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
+		}
+		else
+		{
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
+		}
+		gl_has_errors();
+	}
+
+	// The level mesh has its own vertex format, its buffers are filled in by bakeLevelGeometry
+	glGenVertexArrays(1, &level_VAO);
+	glGenBuffers(1, &level_VBO);
+	glGenBuffers(1, &level_IBO);
+	glBindVertexArray(level_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, level_VBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, level_IBO);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LevelVertex), (void *)offsetof(LevelVertex, position));
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(LevelVertex), (void *)offsetof(LevelVertex, texcoord));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(LevelVertex), (void *)offsetof(LevelVertex, uv_rect));
+	gl_has_errors();
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderSystem::bakeLevelGeometry()
+{
+	level_vertices.clear();
+	level_indices.clear();
+
+	// Adds a quad from top left to bottom right, texcoords are in textures from the top left corner
+	auto addQuad = [&](vec2 top_left, vec2 bottom_right, vec2 uv_top_left, vec2 uv_bottom_right, TEXTURE_ASSET_ID texture) {
+		const vec4 &uv_rect = texture_uv_rects[(GLuint)texture];
+		uint32_t first = (uint32_t)level_vertices.size();
+		level_vertices.push_back({ vec3(top_left.x, top_left.y, 0.f), uv_top_left, uv_rect });
+		level_vertices.push_back({ vec3(bottom_right.x, top_left.y, 0.f), vec2(uv_bottom_right.x, uv_top_left.y), uv_rect });
+		level_vertices.push_back({ vec3(bottom_right.x, bottom_right.y, 0.f), uv_bottom_right, uv_rect });
+		level_vertices.push_back({ vec3(top_left.x, bottom_right.y, 0.f), vec2(uv_top_left.x, uv_bottom_right.y), uv_rect });
+		for (uint32_t index : { 0u, 3u, 1u, 1u, 3u, 2u })
+			level_indices.push_back(first + index);
+	};
+
+	// Floor first so the walls end up on top. Only the open cells get a floor tile, the texture
+	// coordinates run on across tiles so the floor has no seams.
+	const float FLOOR_TEXTURE_SIZE = 64.f;
+	if (registry.gridMaps.size() > 0)
+	{
+		const GridMap &grid = registry.gridMaps.components[0];
+		vec2 cell_size = vec2(grid.mapWidth / (float)grid.matrixWidth, grid.mapHeight / (float)grid.matrixHeight);
+		for (int y = 0; y < grid.matrixHeight; y++)
+		{
+			for (int x = 0; x < grid.matrixWidth; x++)
+			{
+				if (grid.isSolid(x, y))
+					continue;
+				vec2 top_left = vec2(x, y) * cell_size;
+				vec2 bottom_right = top_left + cell_size;
+				addQuad(top_left, bottom_right, top_left / FLOOR_TEXTURE_SIZE, bottom_right / FLOOR_TEXTURE_SIZE, TEXTURE_ASSET_ID::FLOOR);
+			}
+		}
+	}
+
+	// Walls are drawn right way up, the textures are flipped when they are loaded
+	for (Entity entity : registry.walls.entities)
+	{
+		const Motion &motion = registry.wallMotions.get(entity);
+		vec2 half_size = abs(motion.scale) / 2.f;
+		addQuad(motion.position - half_size, motion.position + half_size, vec2(0.f, 1.f), vec2(1.f, 0.f), TEXTURE_ASSET_ID::WALL);
+	}
+
+	glBindVertexArray(level_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, level_VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(LevelVertex) * level_vertices.size(), level_vertices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * level_indices.size(), level_indices.data(), GL_STATIC_DRAW);
+	level_index_count = (GLsizei)level_indices.size();
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// Binds went around the cache
+	bound_vertex_array = vao;
+	bound_array_buffer = 0;
+	gl_has_errors();
+}
+
 RenderSystem::~RenderSystem()
 {
 	// Don't need to free gl resources since they last for as long as the program,
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
-	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	glDeleteVertexArrays((GLsizei)geometry_vaos.size(), geometry_vaos.data());
+	glDeleteVertexArrays((GLsizei)sprite_vaos.size(), sprite_vaos.data());
+	stream_buffer.destroy();
+	glDeleteVertexArrays(1, &level_VAO);
+	glDeleteBuffers(1, &level_VBO);
+	glDeleteBuffers(1, &level_IBO);
+	glDeleteTextures(1, &m_font_atlas);
+	glDeleteTextures((GLsizei)atlas_pages.size(), atlas_pages.data());
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth_stencil);
 	gl_has_errors();
@@ -585,6 +788,9 @@ bool loadEffectFromFile(
 	out_program = glCreateProgram();
 	glAttachShader(out_program, vertex);
 	glAttachShader(out_program, fragment);
+	// Same attribute locations in every program so the geometry VAOs work with all of them
+	glBindAttribLocation(out_program, 0, "in_position");
+	glBindAttribLocation(out_program, 1, "in_texcoord");
 	glLinkProgram(out_program);
 	gl_has_errors();
 
@@ -831,32 +1037,6 @@ bool RenderSystem::initGameBackground() {
 	return true;
 }
 
-bool RenderSystem::initFloor() {
-	glGenTextures(1, &floorTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(floorImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + floorImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, floorTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	gl_has_errors();
-	stbi_image_free(data);
-
-	return true;
-}
-
 bool RenderSystem::initSpaceship() {
 	glGenTextures(1, &spaceshipTexture);
 	
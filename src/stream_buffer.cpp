@@ -0,0 +1,127 @@
+// internal
+#include "stream_buffer.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+bool StreamBuffer::supportsBufferStorage()
+{
+    if (glBufferStorage == nullptr)
+        return false;
+    if (gl3w_is_supported(4, 4))
+        return true;
+    GLint extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (GLint i = 0; i < extension_count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != nullptr && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+            return true;
+    }
+    return false;
+}
+
+void StreamBuffer::init(GLsizeiptr frame_capacity)
+{
+    glGenBuffers(1, &handle);
+    glBindBuffer(GL_ARRAY_BUFFER, handle);
+    capacity = frame_capacity * FRAMES_IN_FLIGHT;
+
+    if (supportsBufferStorage())
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, capacity, nullptr, flags);
+        mapped = (unsigned char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, capacity, flags);
+        assert(mapped != nullptr && "Could not map the stream buffer");
+        // The regions only start moving with the first beginFrame
+        frame = FRAMES_IN_FLIGHT - 1;
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gl_has_errors();
+}
+
+void StreamBuffer::destroy()
+{
+    for (GLsync &fence : fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (mapped != nullptr)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, handle);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &handle);
+    handle = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    GLsizeiptr frame_capacity = capacity / FRAMES_IN_FLIGHT;
+    if (mapped == nullptr)
+    {
+        // Only orphaned between frames, mid-frame it would cut uploads off from draws still to come.
+        // Orphaning hands the waiting for the GPU over to the driver.
+        if (cursor + frame_capacity > capacity)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, handle);
+            glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            cursor = 0;
+        }
+        end = cursor + frame_capacity;
+        return;
+    }
+
+    frame = (frame + 1) % FRAMES_IN_FLIGHT;
+    GLsync &fence = fences[frame];
+    if (fence != nullptr)
+    {
+        // Only blocks when the CPU got a whole FRAMES_IN_FLIGHT ahead
+        GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (glClientWaitSync(fence, wait_flags, 1000000) == GL_TIMEOUT_EXPIRED)
+            wait_flags = 0;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    cursor = frame * frame_capacity;
+    end = cursor + frame_capacity;
+}
+
+void StreamBuffer::endFrame()
+{
+    if (mapped == nullptr)
+        return;
+    assert(fences[frame] == nullptr);
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr StreamBuffer::upload(const void *data, GLsizeiptr size, GLsizeiptr alignment)
+{
+    GLintptr offset = (cursor + alignment - 1) / alignment * alignment;
+    if (offset + size > end)
+        return -1;
+
+    if (mapped != nullptr)
+    {
+        memcpy(mapped + offset, data, size);
+    }
+    else
+    {
+        // Nothing was drawn from this range since the last orphaning, so there is nothing to wait for
+        void *range = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        assert(range != nullptr);
+        memcpy(range, data, size);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    cursor = offset + size;
+    return offset;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+
+// One big buffer that all the geometry rebuilt every frame is sub-allocated from: sprite instances,
+// text quads, the light polygon and the gesture trail. Allocations only ever move forward, so nothing
+// the GPU may still be reading is written over and uploading never has to wait on a draw.
+//
+// With ARB_buffer_storage the buffer is split into one region per frame in flight and mapped once for
+// good, a fence after each frame tells when its region can be written again. Without it every upload
+// maps the untouched range unsynchronized, and a frame that might not fit in what is left of the
+// buffer starts by orphaning it. Either way a frame can use up to frame_capacity bytes.
+class StreamBuffer
+{
+public:
+    // Frames the CPU may run ahead of the GPU before beginFrame waits
+    static const int FRAMES_IN_FLIGHT = 3;
+
+    void init(GLsizeiptr frame_capacity);
+    void destroy();
+
+    // Moves on to the next frame's region, waiting for the GPU to be done with it if needed.
+    // Can bind the buffer to GL_ARRAY_BUFFER.
+    void beginFrame();
+    // Fences off what was allocated this frame
+    void endFrame();
+
+    // Copies size bytes in and returns their offset into the buffer, which is a multiple of alignment
+    // so it can be turned into a first vertex. The buffer has to be bound to GL_ARRAY_BUFFER.
+    // Returns -1 when the frame ran out of room.
+    GLintptr upload(const void *data, GLsizeiptr size, GLsizeiptr alignment);
+
+    GLuint buffer() const { return handle; }
+    bool isPersistent() const { return mapped != nullptr; }
+
+private:
+    static bool supportsBufferStorage();
+
+    GLuint handle = 0;
+    GLsizeiptr capacity = 0;
+    // Only set when the buffer is persistently mapped
+    unsigned char *mapped = nullptr;
+    GLintptr cursor = 0;
+    // Where this frame's room runs out
+    GLintptr end = 0;
+    int frame = 0;
+    std::array<GLsync, FRAMES_IN_FLIGHT> fences = {};
+};
@@ -0,0 +1,80 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int i = 1; i < num_threads; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int)> &job)
+{
+    if (count <= 0)
+        return;
+
+    // Not worth waking anyone up for a single job
+    if (workers.empty() || count == 1)
+    {
+        for (int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current_job = &job;
+        job_count = count;
+        next_job = 0;
+        busy_workers = (int)workers.size();
+        generation++;
+    }
+    start_cv.notify_all();
+
+    run_jobs();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]() { return busy_workers == 0; });
+    current_job = nullptr;
+}
+
+void ThreadPool::run_jobs()
+{
+    for (int i = next_job++; i < job_count; i = next_job++)
+        (*current_job)(i);
+}
+
+void ThreadPool::worker_loop()
+{
+    unsigned int seen_generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [&]() { return stopping || generation != seen_generation; });
+            if (stopping)
+                return;
+            seen_generation = generation;
+        }
+
+        run_jobs();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy_workers == 0)
+            done_cv.notify_one();
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that split an indexed job between them.
+// The calling thread works on the job as well, so a pool of size 1 has no workers and just runs inline.
+class ThreadPool
+{
+public:
+    // num_threads of 0 uses one thread per hardware core
+    explicit ThreadPool(unsigned int num_threads = 0);
+    ~ThreadPool();
+
+    // Total number of threads that take part in a parallel_for, including the caller
+    unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+    // Runs job(i) for every i in [0, count) and returns once all of them are done.
+    // Not re-entrant, only one parallel_for may run on a pool at a time.
+    void parallel_for(int count, const std::function<void(int)> &job);
+
+private:
+    void worker_loop();
+    void run_jobs();
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    unsigned int generation = 0;
+    int busy_workers = 0;
+    bool stopping = false;
+
+    const std::function<void(int)> *current_job = nullptr;
+    int job_count = 0;
+    std::atomic<int> next_job{0};
+};
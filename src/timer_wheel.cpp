@@ -0,0 +1,140 @@
+// internal
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+TimerWheel timers;
+
+void TimerWheel::schedule(Entity owner, TimerKind kind, float delay_ms)
+{
+    // Always at least one tick out, the current tick has already been handled
+    uint64_t ticks = delay_ms > 1.0f ? (uint64_t)std::ceil(delay_ms) : 1;
+    Entry entry = {(unsigned int)owner, kind, next_generation++, now_tick + ticks};
+    live[key(owner, kind)] = {entry.generation, entry.deadline};
+    insert(entry);
+}
+
+void TimerWheel::cancel(Entity owner, TimerKind kind)
+{
+    live.erase(key(owner, kind));
+}
+
+bool TimerWheel::pending(Entity owner, TimerKind kind) const
+{
+    return live.count(key(owner, kind)) > 0;
+}
+
+float TimerWheel::remaining_ms(Entity owner, TimerKind kind) const
+{
+    auto it = live.find(key(owner, kind));
+    if (it == live.end())
+        return 0.0f;
+    return (float)std::max(0.0, (double)it->second.deadline - now_ms);
+}
+
+void TimerWheel::insert(const Entry &entry)
+{
+    uint64_t delta = entry.deadline - now_tick;
+    uint64_t when = delta < MAX_SPAN ? entry.deadline : now_tick + MAX_SPAN - 1;
+    if (delta >= MAX_SPAN)
+        delta = MAX_SPAN - 1;
+
+    // The lowest level whose range still reaches the deadline
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= ((uint64_t)1 << (SLOT_BITS * (level + 1))))
+        level++;
+    int slot = (int)((when >> (SLOT_BITS * level)) & (SLOTS - 1));
+    wheel[level][slot].push_back(entry);
+    occupied[level] |= (uint64_t)1 << slot;
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    moving.clear();
+    moving.swap(wheel[level][slot]);
+    occupied[level] &= ~((uint64_t)1 << slot);
+    for (const Entry &entry : moving)
+    {
+        auto it = live.find(key(Entity(entry.owner), entry.kind));
+        if (it != live.end() && it->second.generation == entry.generation)
+            insert(entry);
+    }
+}
+
+void TimerWheel::fire(int slot)
+{
+    moving.clear();
+    moving.swap(wheel[0][slot]);
+    occupied[0] &= ~((uint64_t)1 << slot);
+    for (const Entry &entry : moving)
+    {
+        auto it = live.find(key(Entity(entry.owner), entry.kind));
+        if (it == live.end() || it->second.generation != entry.generation)
+            continue;
+        assert(entry.deadline == now_tick && "Timer came up on the wrong tick");
+        live.erase(it);
+        expired_by_kind[(int)entry.kind].push_back(Entity(entry.owner));
+    }
+}
+
+float TimerWheel::advance(float elapsed_ms)
+{
+    for (std::vector<Entity> &owners : expired_by_kind)
+        owners.clear();
+
+    float game_ms = elapsed_ms * time_scale;
+    now_ms += game_ms;
+    uint64_t target = (uint64_t)now_ms;
+
+    // Nothing is running, only leftovers of cancelled timers could be waiting in the slots
+    if (live.empty())
+    {
+        for (auto &level : wheel)
+            for (std::vector<Entry> &slot : level)
+                slot.clear();
+        for (uint64_t &bits : occupied)
+            bits = 0;
+        now_tick = target;
+        return game_ms;
+    }
+
+    while (now_tick < target)
+    {
+        // Skip to the next first level slot with entries in it, or to the end of the first level where
+        // the levels above may have to be cascaded down
+        int from = (int)(now_tick & (SLOTS - 1)) + 1;
+        uint64_t ahead = from < SLOTS ? occupied[0] & (~(uint64_t)0 << from) : 0;
+        uint64_t next = ahead ? (now_tick & ~(uint64_t)(SLOTS - 1)) + std::countr_zero(ahead)
+                              : (now_tick | (SLOTS - 1)) + 1;
+        if (next > target)
+        {
+            now_tick = target;
+            break;
+        }
+        now_tick = next;
+
+        // Higher levels first, a slot coming up on the first level has to be complete before it fires
+        for (int level = LEVELS - 1; level > 0; level--)
+        {
+            uint64_t span = (uint64_t)1 << (SLOT_BITS * level);
+            if ((now_tick & (span - 1)) == 0)
+                cascade(level, (int)((now_tick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+        }
+        fire((int)(now_tick & (SLOTS - 1)));
+    }
+    return game_ms;
+}
+
+void TimerWheel::clear()
+{
+    for (auto &level : wheel)
+        for (std::vector<Entry> &slot : level)
+            slot.clear();
+    for (uint64_t &bits : occupied)
+        bits = 0;
+    live.clear();
+    for (std::vector<Entity> &owners : expired_by_kind)
+        owners.clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// What a countdown is for, an entity can have one running timer of each kind
+enum class TimerKind
+{
+    POWER_UP_AVAILABLE = 0,
+    POWER_UP_ACTIVE = POWER_UP_AVAILABLE + 1,
+    DAMAGE_EFFECT = POWER_UP_ACTIVE + 1,
+    LIGHT_UP = DAMAGE_EFFECT + 1,
+    DASH_RECHARGE = LIGHT_UP + 1,
+    RELOAD = DASH_RECHARGE + 1,
+    PATH_REFRESH = RELOAD + 1,
+    ENEMY_SPAWN = PATH_REFRESH + 1,
+    POWER_UP_SPAWN = ENEMY_SPAWN + 1,
+    COUNT = POWER_UP_SPAWN + 1
+};
+
+// Owns the game clock and every countdown in the game. Timers sit in a hierarchical timing wheel with
+// 1ms ticks: the first level holds the next 64ms one slot per tick, every level above covers 64 times
+// as much and is cascaded down a level as its slot comes up. Advancing jumps from one occupied slot
+// to the next, so a frame costs the number of timers that expire, not the number that are running.
+class TimerWheel
+{
+public:
+    // Scales the game time, 0 freezes every countdown and 0.5 is half speed. Pausing doesn't go through
+    // this, the main loop just stops advancing the wheel while the game is paused.
+    float time_scale = 1.0f;
+
+    // Starts, or restarts, the timer of this kind for owner
+    void schedule(Entity owner, TimerKind kind, float delay_ms);
+    void cancel(Entity owner, TimerKind kind);
+    bool pending(Entity owner, TimerKind kind) const;
+    // 0 when there is no such timer
+    float remaining_ms(Entity owner, TimerKind kind) const;
+
+    // Moves the game clock on by elapsed_ms of real time and returns how much game time that was.
+    // Timers that ran out are collected in expired until the next advance.
+    float advance(float elapsed_ms);
+    // Game time since the start, stands still while the game is paused
+    double game_time_ms() const { return now_ms; }
+
+    // Owners whose timer of this kind ran out during the last advance, in the order they ran out.
+    // The owner may have been removed since it was scheduled.
+    const std::vector<Entity> &expired(TimerKind kind) const { return expired_by_kind[(int)kind]; }
+
+    void clear();
+
+private:
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+    // Timers further out wait on the last level until they come into range
+    static const uint64_t MAX_SPAN = (uint64_t)1 << (SLOT_BITS * LEVELS);
+
+    struct Entry
+    {
+        unsigned int owner;
+        TimerKind kind;
+        // Cancelling or rescheduling leaves the old entry in its slot, it is dropped once it comes up
+        unsigned int generation;
+        uint64_t deadline;
+    };
+
+    struct Live
+    {
+        unsigned int generation;
+        uint64_t deadline;
+    };
+
+    static uint64_t key(Entity owner, TimerKind kind) { return ((uint64_t)(unsigned int)owner << 8) | (uint64_t)kind; }
+
+    void insert(const Entry &entry);
+    void cascade(int level, int slot);
+    void fire(int slot);
+
+    double now_ms = 0.0;
+    uint64_t now_tick = 0;
+    unsigned int next_generation = 0;
+    std::vector<Entry> wheel[LEVELS][SLOTS];
+    // One bit per slot that has entries in it
+    uint64_t occupied[LEVELS] = {};
+    std::unordered_map<uint64_t, Live> live;
+    std::vector<Entity> expired_by_kind[(int)TimerKind::COUNT];
+    std::vector<Entry> moving;
+};
+
+extern TimerWheel timers;
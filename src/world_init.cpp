@@ -4,6 +4,7 @@
 #include "render_system.hpp"
 #include "tiny_ecs.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "timer_wheel.hpp"
 #include "world_system.hpp"
 #include "wfc/tiling_wfc.hpp"
 #include "wfc/array2D.hpp"
@@ -13,6 +14,7 @@
 #include <fstream>
 #include <string>
 #include <unordered_set>
+#include <limits>
 LevelStruct level_1 = {1, 5, 0, 0, 2, 0, 2, 5000};
 LevelStruct level_2 = {2, 0, 5, 0, 0, 2, 2, 4000};
 LevelStruct level_3 = {3, 10, 10, 0, 3, 2, 3, 5000};
@@ -170,7 +172,7 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
             f << d.max_dash_charges << "\n";
             f << d.max_dash_time << "\n";
             f << d.recharge_cooldown << "\n";
-            f << d.recharge_timer << "\n";
+            f << timers.remaining_ms(e, TimerKind::DASH_RECHARGE) / 1000.f << "\n";
             f << d.remaining_dash_time << "\n";
         }
         if (registry.walls.has(e))
@@ -207,26 +209,23 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
         }
         if (registry.reloadTimes.has(e))
         {
-            ReloadTime &r = registry.reloadTimes.get(e);
             f << "reload_time" << "\n";
-            f << r.counter_ms << "\n";
-            f << r.shoot_rate << "\n";
-            f << r.take_aim_ms << "\n";
+            f << timers.remaining_ms(e, TimerKind::RELOAD) << "\n";
         }
         if (registry.meleeAttacks.has(e))
         {
             MeleeAttack &m = registry.meleeAttacks.get(e);
             f << "meleeAttack" << "\n";
             f << m.damage << "\n";
-            f << m.windup << "\n";
             f << m.windupMax << "\n";
         }
         if (registry.powerUps.has(e))
         {
             PowerUp &p = registry.powerUps.get(e);
             f << "power_up" << "\n";
-            f << p.available_timer << "\n";
-            f << p.active_timer << "\n";
+            // Time left rather than the durations
+            f << timers.remaining_ms(e, TimerKind::POWER_UP_AVAILABLE) / 1000.f << "\n";
+            f << timers.remaining_ms(e, TimerKind::POWER_UP_ACTIVE) / 1000.f << "\n";
             f << p.active << "\n";
             f << (int)p.type << "\n";
         }
@@ -239,10 +238,12 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
         if (registry.animations.has(e))
         {
             Animation &a = registry.animations.get(e);
+            // Saved as the frame and the time into it, so the animation picks up there on load
+            float now = (float)(timers.game_time_ms() / 1000.0);
             f << "animation" << "\n";
-            f << a.current_time << "\n";
+            f << fmod(max(now - a.start_time, 0.f), a.frame_time) << "\n";
             f << a.frame_time << "\n";
-            f << a.current_frame << "\n";
+            f << a.frameAt(now) << "\n";
             f << a.num_frames << "\n";
             f << a.sprite_width << "\n";
             f << a.sprite_height << "\n";
@@ -257,7 +258,6 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
         {
             Teleporter &t = registry.teleporters.get(e);
             f << "teleporter" << "\n";
-            f << t.animation_time << "\n";
             f << t.max_teleport_time << "\n";
             f << t.prevScale.x << "\n"
               << t.prevScale.y << "\n";
@@ -282,14 +282,16 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
             Pathfinder &pathfinder = registry.pathfinders.get(e);
             f << "pathfinder" << "\n";
             // Just let it find the path again
-            f << pathfinder.refresh_rate << "\n";
+            f << timers.remaining_ms(e, TimerKind::PATH_REFRESH) << "\n";
             f << pathfinder.max_refresh_rate << "\n";
+            // Minions and regular enemies can't be told apart on load, so how they path is kept
+            f << (int)pathfinder.mode << "\n";
+            f << pathfinder.clearance << "\n";
         }
         if (registry.lightUps.has(e))
         {
-            LightUp &l = registry.lightUps.get(e);
             f << "light_up" << "\n";
-            f << l.timer << "\n";
+            f << timers.remaining_ms(e, TimerKind::LIGHT_UP) / 1000.f << "\n";
         }
     }
 }
@@ -297,6 +299,8 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
 void SaveGameToFile(RenderSystem *renderer)
 {
     std::ofstream f("../Save1.data");
+    f << "version" << "\n";
+    f << SAVE_FORMAT_VERSION << "\n";
 
     // Remove all health bars so they do not re-appear when reloaded
     while (registry.healthBars.entities.size() > 0)
@@ -394,7 +398,17 @@ bool LoadGameFromFile(RenderSystem *renderer)
     }
     std::ifstream f("../Save1.data");
 
+    // Fields come without names, so a save written by another version would be read wrong
     std::string line;
+    if (!getline(f, line) || line != "version" || !getline(f, line) || line != std::to_string(SAVE_FORMAT_VERSION))
+    {
+        printf("Save file is from another version of the game, starting a new one\n");
+        return false;
+    }
+
+    // Only the countdowns in the save are running after loading
+    timers.clear();
+
     Entity e;
     while (getline(f, line))
     {
@@ -522,8 +536,10 @@ bool LoadGameFromFile(RenderSystem *renderer)
             d.max_dash_charges = LoadFloat(f);
             d.max_dash_time = LoadFloat(f);
             d.recharge_cooldown = LoadFloat(f);
-            d.recharge_timer = LoadFloat(f);
+            float recharge_timer = LoadFloat(f);
             d.remaining_dash_time = LoadFloat(f);
+            if (d.charges < d.max_dash_charges)
+                timers.schedule(e, TimerKind::DASH_RECHARGE, recharge_timer * 1000.f);
         }
         else if (line == "wall")
         {
@@ -555,25 +571,28 @@ bool LoadGameFromFile(RenderSystem *renderer)
         }
         else if (line == "reload_time")
         {
-            ReloadTime &r = registry.reloadTimes.emplace(e);
-            r.counter_ms = LoadFloat(f);
-            r.shoot_rate = LoadFloat(f);
-            r.take_aim_ms = LoadFloat(f);
+            registry.reloadTimes.emplace(e);
+            float counter_ms = LoadFloat(f);
+            if (counter_ms > 0)
+                timers.schedule(e, TimerKind::RELOAD, counter_ms);
         }
         else if (line == "meleeAttack")
         {
             MeleeAttack &m = registry.meleeAttacks.emplace(e);
             m.damage = LoadInt(f);
-            m.windup = LoadFloat(f);
             m.windupMax = LoadFloat(f);
         }
         else if (line == "power_up")
         {
             PowerUp &p = registry.powerUps.emplace(e);
-            p.available_timer = LoadFloat(f);
-            p.active_timer = LoadFloat(f);
+            float available_timer = LoadFloat(f);
+            float active_timer = LoadFloat(f);
             p.active = LoadBool(f);
             p.type = LoadPowerUpType(f);
+            if (p.active)
+                timers.schedule(e, TimerKind::POWER_UP_ACTIVE, active_timer * 1000.f);
+            else
+                timers.schedule(e, TimerKind::POWER_UP_AVAILABLE, available_timer * 1000.f);
         }
         else if (line == "screen_state")
         {
@@ -583,9 +602,10 @@ bool LoadGameFromFile(RenderSystem *renderer)
         else if (line == "animation")
         {
             Animation &a = registry.animations.emplace(e);
-            a.current_time = LoadFloat(f);
+            float current_time = LoadFloat(f);
             a.frame_time = LoadFloat(f);
-            a.current_frame = LoadInt(f);
+            int current_frame = LoadInt(f);
+            a.start_time = (float)(timers.game_time_ms() / 1000.0) - current_frame * a.frame_time - current_time;
             a.num_frames = LoadInt(f);
             a.sprite_width = LoadInt(f);
             a.sprite_height = LoadInt(f);
@@ -599,7 +619,6 @@ bool LoadGameFromFile(RenderSystem *renderer)
         else if (line == "teleporter")
         {
             Teleporter &t = registry.teleporters.emplace(e);
-            t.animation_time = LoadFloat(f);
             t.max_teleport_time = LoadFloat(f);
             t.prevScale = vec2(LoadFloat(f), LoadFloat(f));
         }
@@ -633,8 +652,12 @@ bool LoadGameFromFile(RenderSystem *renderer)
         else if (line == "pathfinder")
         {
             Pathfinder &p = registry.pathfinders.emplace(e);
-            p.refresh_rate = LoadFloat(f);
+            float refresh_rate = LoadFloat(f);
             p.max_refresh_rate = LoadFloat(f);
+            p.mode = (PathMode)LoadInt(f);
+            p.clearance = LoadInt(f);
+            if (refresh_rate > 0)
+                timers.schedule(e, TimerKind::PATH_REFRESH, refresh_rate);
         }
         else if (line == "gridMap")
         {
@@ -666,23 +689,38 @@ bool LoadGameFromFile(RenderSystem *renderer)
                         gridNode.size.x = LoadFloat(f);
                         gridNode.size.y = LoadFloat(f);
                         gridNode.notWalkable = LoadBool(f);
-                        gridNode.gCost = 1e9;
-                        gridNode.hCost = 0.0f;
-                        gridNode.parentNode = nullptr;
                         gridMap[j][i] = gridNode;
                     }
                 }
             }
             gm.gridMap = gridMap;
+            computeClearanceMap(gm);
+            computeWallDistanceMap(gm);
             printf("%d size \n", registry.gridMaps.size());
         }
         else if (line == "light_up")
         {
-            LightUp &l = registry.lightUps.emplace(e);
-            l.timer = LoadFloat(f);
+            registry.lightUps.emplace(e);
+            timers.schedule(e, TimerKind::LIGHT_UP, LoadFloat(f) * 1000.f);
         }
     }
 
+    // Enemy types aren't saved, they follow from the components that were loaded
+    for (unsigned int i = 0; i < registry.enemies.size(); i++)
+    {
+        Entity e = registry.enemies.entities[i];
+        Enemy &enemy = registry.enemies.components[i];
+        if (registry.necromancers.has(e))
+            enemy.type = EnemyType::NECROMANCER;
+        else if (registry.bosses.has(e))
+            enemy.type = EnemyType::COWBOY;
+        else if (registry.reloadTimes.has(e))
+            enemy.type = EnemyType::RANGED;
+        else
+            enemy.type = EnemyType::MELEE;
+    }
+
+    renderer->bakeLevelGeometry();
     return true;
 }
 
@@ -936,6 +974,8 @@ void GenerateMap(RenderSystem *renderer, int seed)
     gridMapComp.mapHeight = (int)floor(result.height * tileSize.y);
     gridMapComp.matrixWidth = result.width;
     gridMapComp.matrixHeight = result.height;
+    // Every WFC tile above is 5x5 cells
+    gridMapComp.tileCells = 5;
     gridMapVec.resize(result.height);
     for (auto &row : gridMapVec)
     {
@@ -946,14 +986,16 @@ void GenerateMap(RenderSystem *renderer, int seed)
         for (int y = 0; y < result.height; y++)
         {
             int value = result.get(y, x);
-            createGridNode(gridMapVec, vec2(x, y), tileSize, value);
+            bool isBorder = x == 0 || y == 0 || x == result.width - 1 || y == result.height - 1;
+            // Border tiles always get a wall, so the grid has to treat them as one too
+            createGridNode(gridMapVec, vec2(x, y), tileSize, value == 1 || isBorder);
 
             // Outer edge of room or if wfc randomly generates selected tile as wall, create tile)
-            if (value == 1 || x == 0 || y == 0 || x == result.width - 1 || y == result.height - 1)
+            if (value == 1 || isBorder)
             {
                 Entity tile = createTile(renderer, vec2(x, y), tileSize, (TT)value);
                 // add all exposed walls to vector for faster collision detection computatiojns later
-                if (exposed_walls.count({y, x}) > 0 || x == 0 || y == 0 || x == result.width - 1 || y == result.height - 1)
+                if (exposed_walls.count({y, x}) > 0 || isBorder)
                 {
                     gridMapComp.exposed_walls.push_back(tile);
                 }
@@ -961,6 +1003,9 @@ void GenerateMap(RenderSystem *renderer, int seed)
         }
     }
 
+    computeClearanceMap(gridMapComp);
+    computeWallDistanceMap(gridMapComp);
+
     for (Entity e : gridMapComp.exposed_walls) {
         Motion& wallMotion = registry.wallMotions.get(e);
         Motion& exposedWallMotion = registry.exposedWallMotions.emplace(e);
@@ -976,6 +1021,8 @@ void GenerateMap(RenderSystem *renderer, int seed)
 
 
     // std::cout << "EXPOSED WALLS:" << gridMapComp.exposed_walls.size() << std::endl;
+
+    renderer->bakeLevelGeometry();
 }
 
 Entity createTile(RenderSystem *renderer, vec2 pos, vec2 size, TT type)
@@ -988,13 +1035,211 @@ void createGridNode(std::vector<std::vector<GridNode>> &gridMap, vec2 pos, vec2
     GridNode newGridNode = {(pos * size.x) + (size * 0.5f),
                             pos,
                             size,
-                            static_cast<bool>(value),
-                            1e9,
-                            0.0f,
-                            nullptr};
+                            static_cast<bool>(value)};
     gridMap[pos.y][pos.x] = newGridNode;
 }
 
+// Clearance of a cell is its distance in cells to the nearest wall, walls are 0 and cells touching one are 1.
+// Computed once per map so pathfinding can tell how much room an agent has with a single lookup.
+void computeClearanceMap(GridMap &gridMap)
+{
+    std::vector<uint8_t> &clearance = gridMap.clearance;
+    clearance.assign(gridMap.cellCount(), 255);
+
+    std::vector<int> frontier;
+    for (int i = 0; i < gridMap.cellCount(); i++)
+    {
+        ivec2 coord = gridMap.cellCoord(i);
+        if (gridMap.gridMap[coord.y][coord.x].notWalkable)
+        {
+            clearance[i] = 0;
+            frontier.push_back(i);
+        }
+    }
+
+    // Breadth first out from every wall at once, diagonal steps count as one so this is the chessboard distance
+    std::vector<int> next;
+    for (int distance = 1; !frontier.empty() && distance < 255; distance++)
+    {
+        next.clear();
+        for (int cell : frontier)
+        {
+            ivec2 coord = gridMap.cellCoord(cell);
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    ivec2 neighbor = coord + ivec2(dx, dy);
+                    if (neighbor.x < 0 || neighbor.y < 0 || neighbor.x >= gridMap.matrixWidth || neighbor.y >= gridMap.matrixHeight)
+                        continue;
+                    int index = gridMap.cellIndex(neighbor);
+                    if (clearance[index] == 255)
+                    {
+                        clearance[index] = (uint8_t)distance;
+                        next.push_back(index);
+                    }
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+}
+
+// One dimensional squared distance transform (Felzenszwalb & Huttenlocher) over samples spacing apart.
+// The result is the lower envelope of parabolas rooted at every sample.
+static void distanceTransform1D(const std::vector<float> &f, float spacing, std::vector<float> &out,
+                                std::vector<int> &roots, std::vector<float> &bounds)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    int n = (int)f.size();
+    roots.assign(n, 0);
+    bounds.assign(n + 1, 0.0f);
+    out.assign(n, infinity);
+
+    // Where the parabolas of samples q and v cross
+    auto intersection = [&](int q, int v) {
+        float pq = q * spacing, pv = v * spacing;
+        return ((f[q] + pq * pq) - (f[v] + pv * pv)) / (2.0f * (pq - pv));
+    };
+
+    int k = -1;
+    for (int q = 0; q < n; q++)
+    {
+        if (f[q] == infinity)
+            continue;
+        if (k < 0)
+        {
+            k = 0;
+            roots[0] = q;
+            bounds[0] = -infinity;
+            bounds[1] = infinity;
+            continue;
+        }
+        float s = intersection(q, roots[k]);
+        while (s <= bounds[k])
+        {
+            k--;
+            if (k < 0)
+                break;
+            s = intersection(q, roots[k]);
+        }
+        k++;
+        roots[k] = q;
+        bounds[k] = k == 0 ? -infinity : s;
+        bounds[k + 1] = infinity;
+    }
+    if (k < 0)
+        return;
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (bounds[k + 1] < q * spacing)
+            k++;
+        float d = (q - roots[k]) * spacing;
+        out[q] = d * d + f[roots[k]];
+    }
+}
+
+// Exact Euclidean distance from every cell centre to the nearest wall centre, a column pass then a row pass.
+// Also lists the cells that are far enough from walls for spawning.
+void computeWallDistanceMap(GridMap &gridMap)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    int width = gridMap.matrixWidth;
+    int height = gridMap.matrixHeight;
+    vec2 cellSize = vec2(gridMap.mapWidth, gridMap.mapHeight) / vec2(width, height);
+
+    std::vector<float> &distances = gridMap.wallDistances;
+    distances.assign(gridMap.cellCount(), infinity);
+    for (int i = 0; i < gridMap.cellCount(); i++)
+    {
+        ivec2 coord = gridMap.cellCoord(i);
+        if (gridMap.gridMap[coord.y][coord.x].notWalkable)
+            distances[i] = 0.0f;
+    }
+
+    std::vector<float> line, transformed, bounds;
+    std::vector<int> roots;
+    for (int x = 0; x < width; x++)
+    {
+        line.resize(height);
+        for (int y = 0; y < height; y++)
+            line[y] = distances[y * width + x];
+        distanceTransform1D(line, cellSize.y, transformed, roots, bounds);
+        for (int y = 0; y < height; y++)
+            distances[y * width + x] = transformed[y];
+    }
+    for (int y = 0; y < height; y++)
+    {
+        line.assign(distances.begin() + y * width, distances.begin() + (y + 1) * width);
+        distanceTransform1D(line, cellSize.x, transformed, roots, bounds);
+        for (int x = 0; x < width; x++)
+            distances[y * width + x] = sqrt(transformed[x]);
+    }
+
+    gridMap.spawnCells.clear();
+    for (float clearance : SPAWN_CLEARANCES)
+        gridMap.spawnCells.push_back({clearance, {}});
+    for (GridMap::SpawnCells &spawn : gridMap.spawnCells)
+    {
+        for (int i = 0; i < gridMap.cellCount(); i++)
+        {
+            vec2 center = gridMap.cellCenter(i);
+            bool awayFromEdges = center.x >= SPAWN_EDGE_MARGIN && center.y >= SPAWN_EDGE_MARGIN &&
+                                 center.x <= gridMap.mapWidth - SPAWN_EDGE_MARGIN && center.y <= gridMap.mapHeight - SPAWN_EDGE_MARGIN;
+            if (awayFromEdges && distances[i] >= spawn.clearance)
+                spawn.cells.push_back(i);
+        }
+    }
+}
+
+// Picks uniformly among the cells with at least the given clearance that are far enough from avoid. A few
+// random cells are tried first, when they all land too close every cell is counted and one of those picked.
+// Returns false when there is no such cell at all.
+bool pickSpawnPosition(const GridMap &gridMap, float clearance, vec2 avoid, float avoidDistance, std::default_random_engine &rng, vec2 &position)
+{
+    // The smallest list that still keeps the clearance, every cell in it is clear enough
+    const GridMap::SpawnCells *spawn = nullptr;
+    for (const GridMap::SpawnCells &candidate : gridMap.spawnCells)
+    {
+        if (candidate.clearance >= clearance && (!spawn || candidate.clearance < spawn->clearance))
+            spawn = &candidate;
+    }
+    assert(spawn && "No spawn list for this clearance, add it to SPAWN_CLEARANCES");
+    if (!spawn || spawn->cells.empty())
+        return false;
+
+    const std::vector<int> &cells = spawn->cells;
+    std::uniform_int_distribution<int> pick(0, (int)cells.size() - 1);
+    for (int attempt = 0; attempt < SPAWN_SAMPLE_ATTEMPTS; attempt++)
+    {
+        vec2 center = gridMap.cellCenter(cells[pick(rng)]);
+        if (length(center - avoid) >= avoidDistance)
+        {
+            position = center;
+            return true;
+        }
+    }
+
+    int farEnough = 0;
+    for (int cell : cells)
+        farEnough += length(gridMap.cellCenter(cell) - avoid) >= avoidDistance;
+    if (farEnough == 0)
+        return false;
+    int chosen = std::uniform_int_distribution<int>(0, farEnough - 1)(rng);
+    for (int cell : cells)
+    {
+        vec2 center = gridMap.cellCenter(cell);
+        if (length(center - avoid) >= avoidDistance && chosen-- == 0)
+        {
+            position = center;
+            break;
+        }
+    }
+    return true;
+}
+
 Entity createPlayer(RenderSystem *renderer, vec2 pos)
 {
     auto entity = Entity();
@@ -1058,7 +1303,8 @@ Entity createMeleeEnemy(RenderSystem *renderer, vec2 position)
     motion.scale = vec2({multiplier * ENEMY_BB_WIDTH, multiplier * ENEMY_BB_HEIGHT});
 
     // create an empty enemies components
-    registry.enemies.emplace(entity);
+    Enemy &enemy = registry.enemies.emplace(entity);
+    enemy.type = EnemyType::MELEE;
     registry.meleeAttacks.emplace(entity);
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
@@ -1070,7 +1316,8 @@ Entity createMeleeEnemy(RenderSystem *renderer, vec2 position)
     raycast.ray_distance = 1000;
     raycast.ray_width = ENEMY_BB_WIDTH;
 
-    registry.pathfinders.emplace(entity);
+    Pathfinder &pathfinder = registry.pathfinders.emplace(entity);
+    pathfinder.mode = PathMode::FLOW_FIELD;
 
     registry.renderRequests.insert(
         entity,
@@ -1105,8 +1352,10 @@ Entity createRangedEnemy(RenderSystem *renderer, vec2 position)
     motion.scale = vec2({multiplier * ENEMY_BB_WIDTH, multiplier * ENEMY_BB_HEIGHT});
 
     // create an empty enemies component
-    registry.enemies.emplace(entity);
-    registry.reloadTimes.emplace(entity);
+    Enemy &enemy = registry.enemies.emplace(entity);
+    enemy.type = EnemyType::RANGED;
+    ReloadTime &reload = registry.reloadTimes.emplace(entity);
+    timers.schedule(entity, TimerKind::RELOAD, reload.reload_ms);
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
     animation.sprite_width = 32;
@@ -1117,7 +1366,8 @@ Entity createRangedEnemy(RenderSystem *renderer, vec2 position)
     raycast.ray_distance = 1000;
     raycast.ray_width = ENEMY_BB_WIDTH;
 
-    registry.pathfinders.emplace(entity);
+    Pathfinder &pathfinder = registry.pathfinders.emplace(entity);
+    pathfinder.mode = PathMode::FLOW_FIELD;
 
     registry.renderRequests.insert(
         entity,
@@ -1153,10 +1403,12 @@ Entity createCowboyBossEnemy(RenderSystem *renderer, vec2 position)
     motion.scale = vec2({multiplier * ENEMY_BB_WIDTH, multiplier * ENEMY_BB_HEIGHT});
 
     // create an empty enemies component
-    registry.enemies.emplace(entity);
+    Enemy &enemy = registry.enemies.emplace(entity);
+    enemy.type = EnemyType::COWBOY;
 
     // Make more rapid attacks but more time in between
     ReloadTime &bossReload = registry.reloadTimes.emplace(entity);
+    timers.schedule(entity, TimerKind::RELOAD, bossReload.reload_ms);
 
     // Also a melee enemy
     registry.meleeAttacks.emplace(entity);
@@ -1174,7 +1426,8 @@ Entity createCowboyBossEnemy(RenderSystem *renderer, vec2 position)
     raycast.ray_distance = 1000;
     raycast.ray_width = ENEMY_BB_WIDTH;
 
-    registry.pathfinders.emplace(entity);
+    Pathfinder &pathfinder = registry.pathfinders.emplace(entity);
+    pathfinder.mode = PathMode::INCREMENTAL;
 
     registry.renderRequests.insert(
         entity,
@@ -1209,7 +1462,8 @@ Entity createMeleeMinion(RenderSystem *renderer, vec2 position)
     motion.scale = vec2({multiplier * ENEMY_BB_WIDTH, multiplier * ENEMY_BB_HEIGHT});
 
     // create an empty enemies component
-    registry.enemies.emplace(entity);
+    Enemy &enemy = registry.enemies.emplace(entity);
+    enemy.type = EnemyType::MELEE;
     registry.meleeAttacks.emplace(entity);
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
@@ -1221,7 +1475,10 @@ Entity createMeleeMinion(RenderSystem *renderer, vec2 position)
     raycast.ray_distance = 1000;
     raycast.ray_width = ENEMY_BB_WIDTH;
 
-    registry.pathfinders.emplace(entity);
+    Pathfinder &pathfinder = registry.pathfinders.emplace(entity);
+    // Minions are small enough to hug the walls
+    pathfinder.clearance = 1;
+    pathfinder.mode = PathMode::FLOW_FIELD;
 
     registry.renderRequests.insert(
         entity,
@@ -1256,8 +1513,10 @@ Entity createRangedMinion(RenderSystem *renderer, vec2 position)
     motion.scale = vec2({multiplier * ENEMY_BB_WIDTH, multiplier * ENEMY_BB_HEIGHT});
 
     // create an empty enemies component
-    registry.enemies.emplace(entity);
-    registry.reloadTimes.emplace(entity);
+    Enemy &enemy = registry.enemies.emplace(entity);
+    enemy.type = EnemyType::RANGED;
+    ReloadTime &reload = registry.reloadTimes.emplace(entity);
+    timers.schedule(entity, TimerKind::RELOAD, reload.reload_ms);
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
     animation.sprite_width = 32;
@@ -1268,7 +1527,10 @@ Entity createRangedMinion(RenderSystem *renderer, vec2 position)
     raycast.ray_distance = 1000;
     raycast.ray_width = ENEMY_BB_WIDTH;
 
-    registry.pathfinders.emplace(entity);
+    Pathfinder &pathfinder = registry.pathfinders.emplace(entity);
+    // Minions are small enough to hug the walls
+    pathfinder.clearance = 1;
+    pathfinder.mode = PathMode::FLOW_FIELD;
 
     registry.renderRequests.insert(
         entity,
@@ -1304,10 +1566,12 @@ Entity createNecromancerEnemy(RenderSystem *renderer, vec2 position)
     motion.scale = vec2({multiplier * ENEMY_BB_WIDTH, multiplier * ENEMY_BB_HEIGHT});
 
     // create an empty enemies component
-    registry.enemies.emplace(entity);
+    Enemy &enemy = registry.enemies.emplace(entity);
+    enemy.type = EnemyType::NECROMANCER;
 
     // Make more rapid attacks but more time in between
     ReloadTime &bossReload = registry.reloadTimes.emplace(entity);
+    timers.schedule(entity, TimerKind::RELOAD, bossReload.reload_ms);
 
     // Also a melee enemy
     registry.meleeAttacks.emplace(entity);
@@ -1316,7 +1580,8 @@ Entity createNecromancerEnemy(RenderSystem *renderer, vec2 position)
     registry.bosses.emplace(entity);
     registry.necromancers.emplace(entity);
 
-    registry.pathfinders.emplace(entity);
+    Pathfinder &pathfinder = registry.pathfinders.emplace(entity);
+    pathfinder.mode = PathMode::INCREMENTAL;
 
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
@@ -1421,6 +1686,7 @@ Entity createInvincibilityPowerUp(RenderSystem *renderer, vec2 position)
 
     PowerUp &powerUp = registry.powerUps.emplace(entity);
     powerUp.type = PowerUpType::INVINCIBILITY;
+    timers.schedule(entity, TimerKind::POWER_UP_AVAILABLE, powerUp.available_timer * 1000.f);
 
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 50;
@@ -1449,6 +1715,7 @@ Entity createSuperBulletsPowerUp(RenderSystem *renderer, vec2 position)
 
     PowerUp &powerUp = registry.powerUps.emplace(entity);
     powerUp.type = PowerUpType::SUPER_BULLETS;
+    timers.schedule(entity, TimerKind::POWER_UP_AVAILABLE, powerUp.available_timer * 1000.f);
 
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
@@ -1477,6 +1744,7 @@ Entity createHealthStealerPowerUp(RenderSystem *renderer, vec2 position)
 
     PowerUp &powerUp = registry.powerUps.emplace(entity);
     powerUp.type = PowerUpType::HEALTH_STEALER;
+    timers.schedule(entity, TimerKind::POWER_UP_AVAILABLE, powerUp.available_timer * 1000.f);
 
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
@@ -1523,17 +1791,3 @@ Entity createText(RenderSystem *renderer, std::string text, vec2 position, float
 
     return entity;
 }
-
-Entity createText(RenderSystem *renderer, std::string text, vec2 position, float scale, vec3 color, bool timed)
-{
-    Entity entity = Entity();
-
-    Text &screenText = registry.texts.emplace(entity);
-    screenText.text = text;
-    screenText.position = position;
-    screenText.scale = scale;
-    screenText.color = color;
-    screenText.timed = timed;
-
-    return entity;
-}
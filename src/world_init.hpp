@@ -5,6 +5,7 @@
 #include "tiny_ecs.hpp"
 #include "render_system.hpp"
 #include <fstream>
+#include <random>
 
 // These are hardcoded to the dimensions of the entity texture
 // BB = bounding box
@@ -20,6 +21,18 @@ const float PROJECTILE_BB_WIDTH = 0.6f * 75.f;
 const float POWERUP_BB_HEIGHT = 100;
 const float POWERUP_BB_WIDTH = 100;
 
+// How far from wall centres things may appear, and how far from the room's edges spawns stay
+const float MINION_SPAWN_CLEARANCE = 75.f;
+const float SPAWN_CLEARANCE = 100.f;
+const float SPAWN_EDGE_MARGIN = 150.f;
+// Every clearance spawns ask for gets its own list of cells
+const float SPAWN_CLEARANCES[] = {MINION_SPAWN_CLEARANCE, SPAWN_CLEARANCE};
+// How far from the player a teleporting boss and a newly spawned enemy or power up land
+const float TELEPORT_AVOID_DISTANCE = 100.f;
+const float SPAWN_AVOID_DISTANCE = 150.f;
+// Random cells tried before picking among all the cells that are far enough from the player
+const int SPAWN_SAMPLE_ATTEMPTS = 16;
+
 extern LevelStruct* currLevelStruct;
 // level num, num of melee, num of ranged, num of boss, ms between spawns
 extern LevelStruct level_1; 
@@ -63,6 +76,8 @@ struct pair_hash
 
 void initLevels();
 
+// Bumped whenever what the save holds changes, saves of any other version are not loaded
+const int SAVE_FORMAT_VERSION = 1;
 void SaveGameToFile(RenderSystem *renderer);
 void writePart(std::ofstream &f, ComponentContainer<Motion> *container);
 bool LoadGameFromFile(RenderSystem *renderer);
@@ -72,6 +87,9 @@ void NextRoom(RenderSystem *renderer, int seed);
 void GenerateMap(RenderSystem *renderer, int seed);
 Entity createTile(RenderSystem *renderer, vec2 pos, vec2 size, TT type);
 void createGridNode(std::vector<std::vector<GridNode>> &gridMap, vec2 pos, vec2 size, int value);
+void computeClearanceMap(GridMap &gridMap);
+void computeWallDistanceMap(GridMap &gridMap);
+bool pickSpawnPosition(const GridMap &gridMap, float clearance, vec2 avoid, float avoidDistance, std::default_random_engine &rng, vec2 &position);
 // the player
 Entity createPlayer(RenderSystem *renderer, vec2 pos);
 
@@ -96,8 +114,6 @@ Entity createHealthStealerPowerUp(RenderSystem *renderer, vec2 position);
 
 Entity createText(RenderSystem *renderer, std::string text, vec2 position, float scale, vec3 color);
 
-Entity createText(RenderSystem *renderer, std::string text, vec2 position, float scale, vec3 color, bool timed);
-
 Entity createNecromancerEnemy(RenderSystem *renderer, vec2 position);
 
 Entity createMeleeMinion(RenderSystem *renderer, vec2 position);
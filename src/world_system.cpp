@@ -3,13 +3,15 @@
 #include "common.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "floating_text.hpp"
+#include "timer_wheel.hpp"
 #include "world_init.hpp"
 
 // stlib
 #include <GLFW/glfw3.h>
 #include <cassert>
 #include <csignal>
-#include <sstream>
+#include <cstdio>
 #include <string>
 
 #include "physics_system.hpp"
@@ -49,7 +51,7 @@ void WorldSystem::on_window_focus(int focused)
 
 // create the underwater world
 WorldSystem::WorldSystem()
-    : points(0), next_enemy_spawn(0.f), next_power_up_spawn(5.f)
+    : points(0)
 {
     // Seeding rng with random device
     rng = std::default_random_engine(std::random_device()());
@@ -201,9 +203,15 @@ void WorldSystem::init(RenderSystem *renderer_arg)
 
     // Set all states to default
     saveFileExists = renderer->doesSaveFileExist();
+    if (saveFileExists && !LoadGameFromFile(renderer_arg))
+    {
+        // Nothing was loaded from a save that can't be read, it is gone and the menu offers a new game
+        std::remove("../Save1.data");
+        saveFileExists = renderer->doesSaveFileExist();
+        renderer->flipActiveButtions(renderer->getActiveScreen());
+    }
     if (saveFileExists)
     {
-        LoadGameFromFile(renderer_arg);
         // Make the code better later
         init_values();
     }
@@ -235,38 +243,17 @@ bool WorldSystem::mouseOverBox(vec2 mousePos, Entity entity)
 
 vec2 WorldSystem::create_spawn_position()
 {
-    bool is_valid_spawn = false;
-    vec2 spawn_pos;
-
-    vec2 roomTileSize = {50, 50};
-    vec2 roomTileDimensions = {50, 30};
-    float roomWidth = roomTileSize.x * roomTileDimensions.x;
-    float roomHeight = roomTileSize.y * roomTileDimensions.y;
-
-    while (!is_valid_spawn)
+    if (registry.gridMaps.size() <= 0)
     {
-        spawn_pos = {
-            150.f + uniform_dist(rng) * (roomWidth - 300.f),
-            150.f + uniform_dist(rng) * (roomHeight - 300.f)};
-        is_valid_spawn = true;
-
-        // Check if it collides with the player
-        Motion &playerMotion = registry.motions.get(player);
-        if (length(playerMotion.position - spawn_pos) < 150.0f)
-        {
-            is_valid_spawn = false;
-        }
-
-        for (Motion &wall_motion : registry.wallMotions.components)
-        {
-            if (length(wall_motion.position - spawn_pos) < 100.f)
-            {
-                is_valid_spawn = false;
-                break;
-            }
-        }
+        return vec2(window_width_px, window_height_px) / 2.0f;
     }
+    GridMap &gridMap = registry.gridMaps.components[0];
+    Motion &playerMotion = registry.motions.get(player);
 
+    // Every cell in the list is clear of walls, only the player's surroundings need checking. With no room
+    // anywhere things appear in the middle of the room.
+    vec2 spawn_pos = vec2(gridMap.mapWidth, gridMap.mapHeight) / 2.0f;
+    pickSpawnPosition(gridMap, SPAWN_CLEARANCE, playerMotion.position, SPAWN_AVOID_DISTANCE, rng, spawn_pos);
     return spawn_pos;
 }
 
@@ -276,14 +263,19 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     // Show Current Level
     int w, h;
     glfwGetWindowSize(renderer->getWindow(), &w, &h);
+    // The HUD strings only change a few times per level, so they are only formatted when their value does
+    char hudText[64];
     if (!registry.texts.has(showLevel))
     {
-        showLevel = createText(renderer, "Level " + std::to_string(currLevels.current_level + 1), vec2(w / 2 + w * 0.36f, h * 0.07f), 2.0f, {1.0, 0.0, 0.0}, false);
+        shownLevel = currLevels.current_level;
+        snprintf(hudText, sizeof(hudText), "Level %d", shownLevel + 1);
+        showLevel = createText(renderer, hudText, vec2(w / 2 + w * 0.36f, h * 0.07f), 2.0f, {1.0, 0.0, 0.0});
     }
-    else
+    else if (shownLevel != currLevels.current_level)
     {
-        Text &showLevelText = registry.texts.get(showLevel);
-        showLevelText.text = "Level " + std::to_string(currLevels.current_level + 1);
+        shownLevel = currLevels.current_level;
+        snprintf(hudText, sizeof(hudText), "Level %d", shownLevel + 1);
+        registry.texts.get(showLevel).text = hudText;
     }
 
     // Get current level 
@@ -291,15 +283,19 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     int numActiveEnemies = registry.enemies.size();
     int numUnspawnedEnemies = currLevelStruct->num_melee + currLevelStruct->num_ranged + currLevelStruct->num_boss;
     int numEnemiesLeft = numActiveEnemies + numUnspawnedEnemies;
-    std::string numEnemyText = "Enemies remaining: " + std::to_string(numEnemiesLeft);
     if (!registry.texts.has(showProgress)) {
-        showProgress = createText(renderer, numEnemyText, vec2(w*0.015f, h*0.07f), 2.0f, {1.0, 0.0, 0.0}, false);
+        shownEnemiesLeft = numEnemiesLeft;
+        snprintf(hudText, sizeof(hudText), "Enemies remaining: %d", numEnemiesLeft);
+        showProgress = createText(renderer, hudText, vec2(w*0.015f, h*0.07f), 2.0f, {1.0, 0.0, 0.0});
     }
-    else {
-        Text &levelProgressText = registry.texts.get(showProgress);
-        levelProgressText.text = numEnemyText; 
+    else if (shownEnemiesLeft != numEnemiesLeft) {
+        shownEnemiesLeft = numEnemiesLeft;
+        snprintf(hudText, sizeof(hudText), "Enemies remaining: %d", numEnemiesLeft);
+        registry.texts.get(showProgress).text = hudText;
     }
 
+    floatingTexts.advance(elapsed_ms_since_last_update);
+
 
     static int frames = 0;
     static double prevTime = glfwGetTime();
@@ -317,9 +313,13 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
         prevTime = currTime;
         frames = 0;
 
-        std::stringstream title_ss;
-        title_ss << "Ricochet Rage | FPS: " << FPS;
-        glfwSetWindowTitle(window, title_ss.str().c_str());
+        const RenderSystem::RenderStats &stats = renderer->getFrameStats();
+        char title[256];
+        snprintf(title, sizeof(title),
+                 "Ricochet Rage | FPS: %d | Draws: %d | Binds (program/texture/buffer): %d/%d/%d | Sprites drawn/culled: %d/%d | Dropped uploads: %d",
+                 FPS, stats.draw_calls, stats.program_binds, stats.texture_binds, stats.buffer_binds,
+                 stats.sprites_drawn, stats.sprites_culled, stats.dropped_uploads);
+        glfwSetWindowTitle(window, title);
     }
 
     // Remove debug info from the last step
@@ -330,17 +330,16 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     while (registry.healthBars.entities.size() > 0)
         registry.remove_all_components_of(registry.healthBars.entities.back());
 
-    for (Entity entity : registry.texts.entities)
+    // Countdowns run on the timer wheel, only the ones that ran out this frame are visited
+    for (Entity entity : timers.expired(TimerKind::POWER_UP_AVAILABLE))
     {
-        Text &text = registry.texts.get(entity);
-        if (text.timed)
-        {
-            text.timer -= elapsed_ms_since_last_update / 1000.f;
-            if (text.timer < 0)
-            {
-                registry.remove_all_components_of(entity);
-            }
-        }
+        if (registry.powerUps.has(entity) && !registry.powerUps.get(entity).active)
+            registry.remove_all_components_of(entity);
+    }
+    for (Entity entity : timers.expired(TimerKind::POWER_UP_ACTIVE))
+    {
+        if (registry.powerUps.has(entity))
+            registry.remove_all_components_of(entity);
     }
 
     int activePowerUpCount = 0;
@@ -350,35 +349,19 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
         PowerUp &powerUp = registry.powerUps.get(entity);
         if (powerUp.active)
         {
-            powerUp.active_timer -= elapsed_ms_since_last_update / 1000.f;
-            if (powerUp.active_timer < 0)
+            if (powerUp.type == PowerUpType::INVINCIBILITY)
             {
-                registry.remove_all_components_of(entity);
+                registry.colors.get(player) = {0.2f, 0.6f, 0.2f};
             }
-            else
+            else if (powerUp.type == PowerUpType::SUPER_BULLETS)
             {
-                if (powerUp.type == PowerUpType::INVINCIBILITY)
-                {
-                    registry.colors.get(player) = {0.2f, 0.6f, 0.2f};
-                }
-                else if (powerUp.type == PowerUpType::SUPER_BULLETS)
-                {
-                    registry.colors.get(player) = {0.2f, 0.2f, 0.6f};
-                }
-                else
-                {
-                    registry.colors.get(player) = {0.3f, 0.2f, 0.3f};
-                }
+                registry.colors.get(player) = {0.2f, 0.2f, 0.6f};
             }
-            activePowerUpCount++;
-        }
-        else
-        {
-            powerUp.available_timer -= elapsed_ms_since_last_update / 1000.f;
-            if (powerUp.available_timer < 0)
+            else
             {
-                registry.remove_all_components_of(entity);
+                registry.colors.get(player) = {0.3f, 0.2f, 0.3f};
             }
+            activePowerUpCount++;
         }
     }
 
@@ -459,26 +442,24 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     if (damageEffects.has(player))
     {
         DamageEffect &damageEffect = damageEffects.get(player);
-        if (damageEffect.is_attacked)
+        for (Entity entity : timers.expired(TimerKind::DAMAGE_EFFECT))
         {
-            damageEffect.damage_show_time -= elapsed_ms_since_last_update;
-            if (registry.colors.has(player))
+            if (entity == player && damageEffect.is_attacked)
             {
-                vec3 &playerColor = registry.colors.get(player);
-                // make red
-                playerColor = {1.0, 0.0, 0.0};
-                if (damageEffect.damage_show_time < 0)
-                {
-                    damageEffect.damage_show_time = damageEffect.max_show_time;
-                    playerColor = {1, 0.8f, 0.8f};
-                    damageEffect.is_attacked = false;
-                }
+                damageEffect.is_attacked = false;
+                if (registry.colors.has(player))
+                    registry.colors.get(player) = {1, 0.8f, 0.8f};
             }
         }
+        if (damageEffect.is_attacked && registry.colors.has(player))
+        {
+            // make red
+            registry.colors.get(player) = {1.0, 0.0, 0.0};
+        }
     }
 
-    // spawn new enemies
-    next_enemy_spawn -= elapsed_ms_since_last_update * current_speed;
+    // spawn new enemies, the next wave is due once its countdown is no longer running
+    Entity spawn_timer_owner = registry.screenStates.entities[0];
     LevelStruct &curr_level_struct = *currLevels.currStruct;
     bool enemiesLeft = (curr_level_struct.num_melee + curr_level_struct.num_ranged + curr_level_struct.num_boss) > 0;
     int maxBasicEnemies = curr_level_struct.max_active_melee + curr_level_struct.max_active_ranged;
@@ -486,9 +467,10 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     bool canSpawnRanged = currNumRanged < curr_level_struct.max_active_ranged && curr_level_struct.num_ranged > 0;
     
     // Basic enemy spawn
-    if (enemiesLeft && (canSpawnMelee || canSpawnRanged) && next_enemy_spawn < 0.f)
+    if (enemiesLeft && (canSpawnMelee || canSpawnRanged) && !timers.pending(spawn_timer_owner, TimerKind::ENEMY_SPAWN))
     {
-        next_enemy_spawn = (curr_level_struct.enemy_spawn_time * 0.5) + uniform_dist(rng) * curr_level_struct.enemy_spawn_time;
+        timers.schedule(spawn_timer_owner, TimerKind::ENEMY_SPAWN,
+                        (curr_level_struct.enemy_spawn_time * 0.5) + uniform_dist(rng) * curr_level_struct.enemy_spawn_time);
 
         for (int i = 0; i < curr_level_struct.wave_size; i++) {
             maxBasicEnemies = curr_level_struct.max_active_melee + curr_level_struct.max_active_ranged;
@@ -556,7 +538,8 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     if (!enemiesLeft && (int)registry.enemies.entities.size() == 0 && (int)registry.lightUps.entities.size() == 0)
     {
         Entity screen_state_entity = registry.screenStates.entities[0];
-        registry.lightUps.emplace(screen_state_entity);
+        LightUp &lightUp = registry.lightUps.emplace(screen_state_entity);
+        timers.schedule(screen_state_entity, TimerKind::LIGHT_UP, lightUp.timer * 1000.f);
 
         Motion &motion = registry.motions.get(player);
         motion.velocity = vec2(0, 0);
@@ -567,10 +550,11 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     Entity screen_state_entity = registry.screenStates.entities[0];
     if (registry.lightUps.has(screen_state_entity))
     {
-        LightUp &lightUp = registry.lightUps.get(screen_state_entity);
-        lightUp.timer -= elapsed_ms_since_last_update / 1000.f;
+        bool lightUpOver = false;
+        for (Entity entity : timers.expired(TimerKind::LIGHT_UP))
+            lightUpOver = lightUpOver || entity == screen_state_entity;
 
-        if (lightUp.timer < 0)
+        if (lightUpOver)
         {
             registry.lightUps.remove(screen_state_entity);
 
@@ -602,10 +586,9 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     }
 
     // spawn power ups
-    next_power_up_spawn -= elapsed_ms_since_last_update * current_speed;
-    if (next_power_up_spawn < 0.f)
+    if (!timers.pending(spawn_timer_owner, TimerKind::POWER_UP_SPAWN))
     {
-        next_power_up_spawn = POWER_UP_SPAWN_DELAY_MS;
+        timers.schedule(spawn_timer_owner, TimerKind::POWER_UP_SPAWN, POWER_UP_SPAWN_DELAY_MS);
         vec2 spawn_pos = create_spawn_position();
         float spawn_power_up = uniform_dist(rng);
 
@@ -655,7 +638,10 @@ void WorldSystem::reset_level()
 void WorldSystem::init_values()
 {
     // Reset the game speed
-    current_speed = 1.f;
+    timers.time_scale = 1.f;
+
+    // The first wave comes right away, the first power up shortly after
+    timers.schedule(registry.screenStates.entities[0], TimerKind::POWER_UP_SPAWN, 5.f);
 
     // Reset the number of enemies seen
     num_enemies_seen = 0;
@@ -671,6 +657,11 @@ void WorldSystem::restart_game()
     // Debugging for memory/component leaks
     registry.list_all_components();
     printf("Restarting\n");
+    floatingTexts.clear();
+    // Countdowns of the last run would otherwise go off on entities that are gone. A level transition
+    // that was still lighting up goes with them, it could never end now.
+    timers.clear();
+    registry.lightUps.clear();
 
     // Remove all entities that we created
     // All that have a motion, we could also iterate over all fish, eels, ... but that would be more cumbersome
@@ -770,7 +761,7 @@ void WorldSystem::projectile_hit_character(Entity laser, Entity character)
             characterPos = registry.enemyMotions.get(character).position;
         }
         vec2 updatedPosition = renderer->calculatePosInCamera(characterPos);
-        createText(renderer, "-" + std::to_string(damage), updatedPosition, scale, color);
+        floatingTexts.spawn(updatedPosition, scale, color, "-%d", damage);
         health_check(health, character);
 
         if (steal_health && !is_character_player)
@@ -796,7 +787,6 @@ void WorldSystem::health_check(Health &health, const Entity &character)
                 registry.motions.get(character).velocity = vec2(0, 0);
 
                 Animation &player_anim = registry.animations.get(character);
-                player_anim.current_frame = 0;
                 player_anim.is_playing = false;
                 registry.colors.get(character) = {1.0f, 0.0f, 0.0f}; // red
 
@@ -837,63 +827,43 @@ void WorldSystem::handle_collisions(float elapsed_ms)
         // for now, we are only interested in collisions that involve the player
         if (registry.players.has(entity))
         {
-            if (registry.enemies.has(entity_other) || registry.walls.has(entity_other))
+            // Walls are resolved by the character controller during the physics step, only enemies push the player here
+            if (registry.enemies.has(entity_other) && registry.gridMaps.size() > 0)
             {
                 Motion &playerMotion = registry.motions.get(entity);
-                Motion wallMotion;
-                if (registry.enemies.has(entity_other))
-                {
-                    wallMotion = registry.enemyMotions.get(entity_other);
-                }
-                else
-                {
-                    wallMotion = registry.wallMotions.get(entity_other);
-                }
+                Motion &enemyMotion = registry.enemyMotions.get(entity_other);
 
-                vec2 diff = playerMotion.position - wallMotion.position;
-                vec2 wallNorm;
+                vec2 diff = playerMotion.position - enemyMotion.position;
+                vec2 enemyNorm;
 
-                if (abs(diff.y / wallMotion.scale.y) < abs(diff.x / wallMotion.scale.x))
+                if (abs(diff.y / enemyMotion.scale.y) < abs(diff.x / enemyMotion.scale.x))
                 {
-                    wallNorm = {1.0f, 0.0f};
+                    enemyNorm = {1.0f, 0.0f};
                 }
                 else
                 {
-                    wallNorm = {0.0f, 1.0f};
+                    enemyNorm = {0.0f, 1.0f};
                 }
 
-                vec2 slideVelocity = playerMotion.velocity - dot(playerMotion.velocity, wallNorm) * wallNorm;
+                vec2 slideVelocity = playerMotion.velocity - dot(playerMotion.velocity, enemyNorm) * enemyNorm;
 
                 float bufferGap = 1.0f;
-                float xOverlap = (playerMotion.scale.x / 2 + wallMotion.scale.x / 2 - playerMotion.scale.x + bufferGap) - abs(diff.x);
-                float yOverlap = (playerMotion.scale.y / 2 + wallMotion.scale.y / 2 + bufferGap) - abs(diff.y);
+                float xOverlap = (playerMotion.scale.x / 2 + enemyMotion.scale.x / 2 - playerMotion.scale.x + bufferGap) - abs(diff.x);
+                float yOverlap = (playerMotion.scale.y / 2 + enemyMotion.scale.y / 2 + bufferGap) - abs(diff.y);
 
-                if (wallNorm.x == 1.0f && xOverlap > 0)
+                // The push goes through the controller as well so an enemy can never shove the player into a wall
+                vec2 push = {0.0f, 0.0f};
+                if (enemyNorm.x == 1.0f && xOverlap > 0)
                 {
-
-                    if (diff.x < 0)
-                    {
-                        playerMotion.position.x -= xOverlap;
-                    }
-                    else
-                    {
-                        playerMotion.position.x += xOverlap;
-                    }
+                    push.x = diff.x < 0 ? -xOverlap : xOverlap;
                     playerMotion.velocity.x = slideVelocity.x;
                 }
-                else if (wallNorm.y == 1.0f && yOverlap > 0)
+                else if (enemyNorm.y == 1.0f && yOverlap > 0)
                 {
-
-                    if (diff.y < 0)
-                    {
-                        playerMotion.position.y -= yOverlap;
-                    }
-                    else
-                    {
-                        playerMotion.position.y += yOverlap;
-                    }
+                    push.y = diff.y < 0 ? -yOverlap : yOverlap;
                     playerMotion.velocity.y = slideVelocity.y;
                 }
+                PhysicsSystem::moveAndSlide(playerMotion, push, registry.gridMaps.components[0]);
             }
 
             if (
@@ -909,6 +879,8 @@ void WorldSystem::handle_collisions(float elapsed_ms)
                 PowerUp &powerUp = registry.powerUps.get(entity_other);
                 powerUp.active = true;
                 registry.renderRequests.remove(entity_other);
+                timers.cancel(entity_other, TimerKind::POWER_UP_AVAILABLE);
+                timers.schedule(entity_other, TimerKind::POWER_UP_ACTIVE, powerUp.active_timer * 1000.f);
 
                 if (powerUp.type == PowerUpType::INVINCIBILITY)
                     Mix_PlayChannel(-1, invincibility_sound, 0);
@@ -944,66 +916,9 @@ void WorldSystem::handle_collisions(float elapsed_ms)
             }
         }
 
-        // collision between enemies and walls
+        // collision between enemies and projectiles
         else if (registry.enemies.has(entity))
         {
-            if (registry.walls.has(entity_other))
-            {
-                if (registry.enemyMotions.has(entity))
-                {
-
-                    Motion &enemyMotion = registry.enemyMotions.get(entity);
-                    Motion &wallMotion = registry.wallMotions.get(entity_other);
-
-                    vec2 diff = enemyMotion.position - wallMotion.position;
-                    vec2 wallNorm;
-
-                    if (abs(diff.y / wallMotion.scale.y) < abs(diff.x / wallMotion.scale.x))
-                    {
-                        wallNorm = {1.0f, 0.0f};
-                    }
-                    else
-                    {
-                        wallNorm = {0.0f, 1.0f};
-                    }
-
-                    vec2 slideVelocity = enemyMotion.velocity - dot(enemyMotion.velocity, wallNorm) * wallNorm;
-
-                    float bufferGap = 1.0f;
-                    float xOverlap = (enemyMotion.scale.x / 2 + wallMotion.scale.x / 2 - enemyMotion.scale.x + bufferGap) - abs(diff.x);
-                    float yOverlap = (enemyMotion.scale.y / 2 + wallMotion.scale.y / 2 + bufferGap) - abs(diff.y);
-
-                    if (wallNorm.x == 1.0f && xOverlap > 0)
-                    {
-
-                        if (diff.x < 0)
-                        {
-                            enemyMotion.position.x -= xOverlap;
-                        }
-                        else
-                        {
-                            enemyMotion.position.x += xOverlap;
-                        }
-                        enemyMotion.velocity.x = slideVelocity.x;
-                    }
-                    else if (wallNorm.y == 1.0f && yOverlap > 0)
-                    {
-
-                        if (diff.y < 0)
-                        {
-                            enemyMotion.position.y -= yOverlap;
-                        }
-                        else
-                        {
-                            enemyMotion.position.y += yOverlap;
-                        }
-                        enemyMotion.velocity.y = slideVelocity.y;
-                    }
-                }
-            }
-
-            // Test for projectile hitting enemy
-
             if (registry.projectiles.has(entity_other))
             {
                 Projectile p = registry.projectiles.get(entity_other);
@@ -1103,7 +1018,7 @@ void WorldSystem::on_key(int key, int, int action, int mod)
             if (player_dash.charges > 0)
             {
                 player_dash.charges--;
-                player_dash.recharge_timer = player_dash.recharge_cooldown;
+                timers.schedule(player, TimerKind::DASH_RECHARGE, player_dash.recharge_cooldown * 1000.f);
                 player_dash.remaining_dash_time = player_dash.max_dash_time;
                 player_dash.dash_direction = motion.last_move_direction;
             }
@@ -1193,15 +1108,15 @@ void WorldSystem::on_key(int key, int, int action, int mod)
     // Control the current speed with `<` `>`
     // if (action == GLFW_RELEASE && (mod & GLFW_MOD_SHIFT) && key == GLFW_KEY_COMMA)
     // {
-    //     current_speed -= 0.1f;
-    //     printf("Current speed = %f\n", current_speed);
+    //     timers.time_scale -= 0.1f;
+    //     printf("Current speed = %f\n", timers.time_scale);
     // }
     // if (action == GLFW_RELEASE && (mod & GLFW_MOD_SHIFT) && key == GLFW_KEY_PERIOD)
     // {
-    //     current_speed += 0.1f;
-    //     printf("Current speed = %f\n", current_speed);
+    //     timers.time_scale += 0.1f;
+    //     printf("Current speed = %f\n", timers.time_scale);
     // }
-    current_speed = fmax(0.f, current_speed);
+    timers.time_scale = fmax(0.f, timers.time_scale);
 }
 
 void WorldSystem::on_mouse_move(vec2 mouse_position)
@@ -1281,7 +1196,7 @@ void WorldSystem::on_mouse_move(vec2 mouse_position)
                         glfwGetWindowSize(window, &w, &h);
                         // Motion.position assumes top right is (window_width_px, window_height_px) when the y axis is actually flipped, so negative offset
                         vec2 textOffset = vec2(0.01 * w, -0.01 * h);
-                        createText(renderer, "+ 50", vec2(w / 2, h / 2) + textOffset, 1.25f, {0.0, 1.0, 0.0});
+                        floatingTexts.spawn(vec2(w / 2, h / 2) + textOffset, 1.25f, {0.0, 1.0, 0.0}, "+ 50");
                     }
                 }
                 // Just delete everything from the gesturePath
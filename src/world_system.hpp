@@ -71,13 +71,10 @@ private:
 
     // Number of points attained by player, displayed in the window title
     unsigned int points;
-    float next_enemy_spawn;
-    float next_power_up_spawn;
 
     // Game state
     RenderSystem *renderer;
     bool m_isPaused = true;
-    float current_speed;
     Entity player;
     bool saveFileExists = false;
 
@@ -104,6 +101,9 @@ private:
     Entity showLevel;
 
     Entity showProgress;
+    // Values the HUD texts were last built for, their strings are only rebuilt when these change
+    int shownLevel = -1;
+    int shownEnemiesLeft = -1;
     int startingNumEnemies;
 
 